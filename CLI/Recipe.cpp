@@ -0,0 +1,143 @@
+#include "Recipe.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+bool readColor(const QJsonObject &obj, const char *key, QColor *color,
+               QString *error) {
+  if (!obj.contains(key)) {
+    *error = QString("missing \"%1\"").arg(key);
+    return false;
+  }
+
+  *color = QColor::fromString(obj.value(key).toString());
+  if (!color->isValid()) {
+    *error = QString("invalid colour \"%1\" for \"%2\"")
+                 .arg(obj.value(key).toString(), key);
+    return false;
+  }
+  return true;
+}
+
+bool readMetric(const QJsonObject &obj, ColorMetric *metric, QString *error) {
+  if (!obj.contains("metric"))
+    return true;
+
+  const QString name = obj.value("metric").toString();
+  if (name == "perChannel")
+    *metric = ColorMetric::PerChannel;
+  else if (name == "euclideanRgb")
+    *metric = ColorMetric::EuclideanRgb;
+  else if (name == "cieLab")
+    *metric = ColorMetric::CieLab;
+  else if (name == "premultiplied")
+    *metric = ColorMetric::Premultiplied;
+  else {
+    *error = QString("unknown metric \"%1\"").arg(name);
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool Recipe::isEmpty() const {
+  return colorSwaps.isEmpty() && guideChecks.isEmpty() && !alphaCheck &&
+         !speckCleanup;
+}
+
+bool Recipe::load(const QString &path, Recipe *recipe, QString *error) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    *error = file.errorString();
+    return false;
+  }
+
+  QJsonParseError parseError;
+  const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+  if (doc.isNull()) {
+    *error = parseError.errorString();
+    return false;
+  }
+  if (!doc.isObject()) {
+    *error = "top level must be an object";
+    return false;
+  }
+  const QJsonObject root = doc.object();
+
+  const QJsonArray swaps = root.value("colorSwaps").toArray();
+  for (int i = 0; i < swaps.size(); ++i) {
+    const QJsonObject obj = swaps[i].toObject();
+    ColorSwap swap;
+    QString why;
+    if (!readColor(obj, "source", &swap.source, &why) ||
+        !readColor(obj, "dest", &swap.dest, &why) ||
+        !readMetric(obj, &swap.metric, &why)) {
+      *error = QString("colorSwaps[%1]: %2").arg(i).arg(why);
+      return false;
+    }
+    swap.tolerance = obj.value("tolerance").toInt(swap.tolerance);
+    swap.enabled = obj.value("enabled").toBool(swap.enabled);
+    recipe->colorSwaps.append(swap);
+  }
+
+  const QJsonArray guides = root.value("guideChecks").toArray();
+  for (int i = 0; i < guides.size(); ++i) {
+    const QJsonObject obj = guides[i].toObject();
+    GuideColorParams params;
+    QString why;
+    if (!readColor(obj, "source", &params.sourceColor, &why) ||
+        !readColor(obj, "selection", &params.selectionColor, &why) ||
+        !readMetric(obj, &params.metric, &why)) {
+      *error = QString("guideChecks[%1]: %2").arg(i).arg(why);
+      return false;
+    }
+    params.radius = obj.value("radius").toInt(params.radius);
+    params.thickness = obj.value("thickness").toInt(params.thickness);
+    params.tolerance = obj.value("tolerance").toInt(params.tolerance);
+    params.enabled = obj.value("enabled").toBool(params.enabled);
+    recipe->guideChecks.append(params);
+  }
+
+  if (root.contains("alphaCheck")) {
+    const QJsonObject obj = root.value("alphaCheck").toObject();
+    AlphaCheckParams &params = recipe->alphaParams;
+    if (obj.contains("crossColor")) {
+      QString why;
+      if (!readColor(obj, "crossColor", &params.crossColor, &why)) {
+        *error = QString("alphaCheck: %1").arg(why);
+        return false;
+      }
+    }
+    params.crossSize = obj.value("crossSize").toInt(params.crossSize);
+    params.thickness = obj.value("thickness").toInt(params.thickness);
+    recipe->alphaCheck = obj.value("enabled").toBool(true);
+  }
+
+  if (root.contains("speckCleanup")) {
+    const QJsonObject obj = root.value("speckCleanup").toObject();
+    SpeckCleanupParams &params = recipe->speckParams;
+    if (obj.contains("markerColor")) {
+      QString why;
+      if (!readColor(obj, "markerColor", &params.markerColor, &why)) {
+        *error = QString("speckCleanup: %1").arg(why);
+        return false;
+      }
+    }
+    params.maxArea = obj.value("maxArea").toInt(params.maxArea);
+    if (params.maxArea < 1 || params.maxArea > SpeckCleanupParams::MaxArea) {
+      *error = QString("speckCleanup: \"maxArea\" must be 1 to %1")
+                   .arg(SpeckCleanupParams::MaxArea);
+      return false;
+    }
+    params.absorb = obj.value("absorb").toBool(params.absorb);
+    params.markerRadius = obj.value("markerRadius").toInt(params.markerRadius);
+    params.thickness = obj.value("thickness").toInt(params.thickness);
+    recipe->speckCleanup = obj.value("enabled").toBool(true);
+  }
+
+  return true;
+}
@@ -0,0 +1,42 @@
+#ifndef RECIPE_H
+#define RECIPE_H
+
+#include "CelPaintTypes.h"
+#include <QList>
+#include <QString>
+
+// Batch recipe for celpaint-cli, read from a JSON file:
+//
+// {
+//   "colorSwaps": [
+//     { "source": "#ff0000", "dest": "#00ff00", "tolerance": 0 }
+//   ],
+//   "guideChecks": [
+//     { "source": "#0000ff", "selection": "#ff00ff",
+//       "radius": 10, "thickness": 2, "tolerance": 0 }
+//   ],
+//   "alphaCheck": { "crossColor": "#ff0000", "crossSize": 10, "thickness": 2 },
+//   "speckCleanup": { "maxArea": 5, "absorb": true }
+// }
+//
+// Every section is optional. Entries accept "enabled": false like their UI
+// counterparts, and swaps and guide checks accept "metric": one of
+// "perChannel" (default), "euclideanRgb", "cieLab" or "premultiplied".
+// Speck cleanup marks specks with "markerColor" unless "absorb" is true;
+// "maxArea" must be 1 to 256 pixels.
+// Steps run in the order swaps, speck cleanup, guide check, alpha check.
+struct Recipe {
+  QList<ColorSwap> colorSwaps;
+  QList<GuideColorParams> guideChecks;
+  bool alphaCheck = false;
+  AlphaCheckParams alphaParams;
+  bool speckCleanup = false;
+  SpeckCleanupParams speckParams;
+
+  bool isEmpty() const;
+
+  // Returns false and sets error when the file is unreadable or malformed
+  static bool load(const QString &path, Recipe *recipe, QString *error);
+};
+
+#endif // RECIPE_H
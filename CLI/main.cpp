@@ -0,0 +1,219 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cstdio>
+
+#include "ImageSequence.h"
+#include "Recipe.h"
+
+// Exit codes, stable for render-farm job scripts
+enum ExitCode {
+  ExitOk = 0,
+  ExitUsage = 1,        // Bad arguments
+  ExitRecipe = 2,       // Recipe unreadable or malformed
+  ExitInput = 3,        // Input folder missing or without frames
+  ExitOutput = 4,       // Output folder cannot be created
+  ExitFramesFailed = 5, // Some frames could not be read or written
+};
+
+struct FrameJob {
+  QString sourcePath;
+  QString targetPath;
+  QString format;
+
+  // Results
+  bool readOk = false;
+  bool writeOk = false;
+  bool modified = false;
+  double readMs = 0;
+  double processMs = 0;
+  double writeMs = 0;
+};
+
+static double elapsedMs(const QElapsedTimer &timer) {
+  return timer.nsecsElapsed() / 1e6;
+}
+
+// Runs the recipe on one frame. Each frame is independent, so this is mapped
+// over the worker pool; the swap kernel is built once and shared.
+static FrameJob processFrame(FrameJob job, const Recipe &recipe,
+                             const ColorSwapKernel &swapKernel) {
+  QElapsedTimer timer;
+  timer.start();
+  QImage image = ImageSequence::readFrameFile(job.sourcePath);
+  job.readMs = elapsedMs(timer);
+  job.readOk = !image.isNull();
+  if (!job.readOk)
+    return job;
+
+  timer.restart();
+  job.modified |= ImageSequence::replaceColorsInImage(image, swapKernel);
+  if (recipe.speckCleanup && recipe.speckParams.absorb)
+    job.modified |= ImageSequence::absorbSpecks(image, recipe.speckParams);
+
+  // Every check sees the frame without markers; they are painted last so no
+  // check finds another's circles or crosses
+  QList<QcMarker> markers;
+  if (recipe.speckCleanup && !recipe.speckParams.absorb)
+    markers += ImageSequence::speckMarkers(image, recipe.speckParams);
+  markers += ImageSequence::guideCheckMarkers(image, recipe.guideChecks);
+  if (recipe.alphaCheck)
+    markers += ImageSequence::alphaCheckMarkers(image, recipe.alphaParams);
+  ImageSequence::paintMarkers(image, markers);
+  job.modified |= !markers.isEmpty();
+  job.processMs = elapsedMs(timer);
+
+  timer.restart();
+  job.writeOk =
+      ImageSequence::writeFrameFile(image, job.targetPath, job.format);
+  job.writeMs = elapsedMs(timer);
+  return job;
+}
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("celpaint-cli");
+  app.setApplicationVersion("0.1");
+  app.setOrganizationName("CelPaint");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Applies a colour swap / guide check / alpha check recipe to every "
+      "frame in a folder.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addPositionalArgument("input", "Folder containing the frames.");
+  parser.addPositionalArgument("recipe", "JSON recipe file.");
+  parser.addPositionalArgument("output", "Folder to write processed frames.");
+
+  QCommandLineOption jobsOption(
+      {"j", "jobs"}, "Number of worker threads (default: one per core).",
+      "count");
+  QCommandLineOption formatOption(
+      {"f", "format"},
+      "Output format such as png or tga (default: keep each source format).",
+      "format");
+  QCommandLineOption quietOption({"q", "quiet"},
+                                 "Only print failures and the summary.");
+  parser.addOption(jobsOption);
+  parser.addOption(formatOption);
+  parser.addOption(quietOption);
+  parser.process(app);
+
+  const QStringList args = parser.positionalArguments();
+  if (args.size() != 3) {
+    std::fprintf(stderr, "%s\n", qPrintable(parser.helpText()));
+    return ExitUsage;
+  }
+
+  int jobs = QThread::idealThreadCount();
+  if (parser.isSet(jobsOption)) {
+    bool ok = false;
+    jobs = parser.value(jobsOption).toInt(&ok);
+    if (!ok || jobs < 1) {
+      std::fprintf(stderr, "Invalid job count: %s\n",
+                   qPrintable(parser.value(jobsOption)));
+      return ExitUsage;
+    }
+  }
+  const QString format = parser.value(formatOption).toLower();
+  const bool quiet = parser.isSet(quietOption);
+
+  Recipe recipe;
+  QString error;
+  if (!Recipe::load(args[1], &recipe, &error)) {
+    std::fprintf(stderr, "Cannot load recipe %s: %s\n", qPrintable(args[1]),
+                 qPrintable(error));
+    return ExitRecipe;
+  }
+  if (recipe.isEmpty())
+    std::fprintf(stderr, "Recipe has no steps; frames are copied as is.\n");
+
+  QDir inputDir(args[0]);
+  if (!inputDir.exists()) {
+    std::fprintf(stderr, "Input folder does not exist: %s\n",
+                 qPrintable(args[0]));
+    return ExitInput;
+  }
+  QStringList files = inputDir.entryList(ImageSequence::imageNameFilters(),
+                                         QDir::Files, QDir::Name);
+  if (files.isEmpty()) {
+    std::fprintf(stderr, "No image files found in %s\n", qPrintable(args[0]));
+    return ExitInput;
+  }
+  std::sort(files.begin(), files.end());
+
+  QDir outputDir(args[2]);
+  if (!outputDir.mkpath(".")) {
+    std::fprintf(stderr, "Cannot create output folder: %s\n",
+                 qPrintable(args[2]));
+    return ExitOutput;
+  }
+
+  QList<FrameJob> frameJobs;
+  for (const QString &file : files) {
+    QFileInfo source(inputDir.filePath(file));
+    FrameJob job;
+    job.sourcePath = source.absoluteFilePath();
+    job.format = format.isEmpty() ? source.suffix() : format;
+    job.targetPath = outputDir.absoluteFilePath(
+        format.isEmpty() ? source.fileName()
+                         : source.completeBaseName() + "." + format);
+    frameJobs.append(job);
+  }
+
+  // Frames share the global pool with the per-frame work (swap bands,
+  // region labelling bands), so -j caps every thread the run uses. Blocking
+  // maps started inside a worker run on that worker and only borrow idle
+  // threads.
+  QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+
+  const ColorSwapKernel swapKernel(recipe.colorSwaps);
+  QElapsedTimer total;
+  total.start();
+  QFuture<FrameJob> future = QtConcurrent::mapped(
+      frameJobs, [&recipe, &swapKernel](const FrameJob &job) {
+        return processFrame(job, recipe, swapKernel);
+      });
+
+  // Results are reported in file order as they become available
+  int modified = 0;
+  int failed = 0;
+  const int count = frameJobs.size();
+  for (int i = 0; i < count; ++i) {
+    const FrameJob job = future.resultAt(i);
+    const QString name = QFileInfo(job.sourcePath).fileName();
+
+    if (!job.readOk) {
+      ++failed;
+      std::fprintf(stderr, "[%d/%d] %s: cannot read\n", i + 1, count,
+                   qPrintable(name));
+      continue;
+    }
+    if (!job.writeOk) {
+      ++failed;
+      std::fprintf(stderr, "[%d/%d] %s: cannot write %s\n", i + 1, count,
+                   qPrintable(name), qPrintable(job.targetPath));
+      continue;
+    }
+
+    if (job.modified)
+      ++modified;
+    if (!quiet) {
+      std::printf("[%d/%d] %s  read %.1f ms  process %.1f ms  write %.1f ms%s\n",
+                  i + 1, count, qPrintable(name), job.readMs, job.processMs,
+                  job.writeMs, job.modified ? "  modified" : "");
+      std::fflush(stdout);
+    }
+  }
+
+  std::printf("%d frames, %d modified, %d failed in %.2f s with %d workers\n",
+              count, modified, failed, elapsedMs(total) / 1000.0, jobs);
+  return failed > 0 ? ExitFramesFailed : ExitOk;
+}
@@ -22,21 +22,86 @@ AppController::AppController(ImageSequence *sequence, QObject *parent)
       m_colorSwapModel(new ColorSwapModel(this)),
       m_guideCheckModel(new GuideCheckModel(this)),
       m_timelineModel(new TimelineModel(sequence, this)),
-      m_undoStack(new QUndoStack(this)) {
+      m_undoStack(new QUndoStack(this)),
+      m_swapPreview(new SwapPreview(sequence, this)) {
+  connect(m_undoStack, &QUndoStack::indexChanged, this,
+          &AppController::trimUndoHistory);
+  connect(m_undoStack, &QUndoStack::indexChanged, this,
+          &AppController::undoStateChanged);
   connect(m_sequence, &ImageSequence::sequenceLoaded, this,
           &AppController::onSequenceLoaded);
   connect(m_sequence, &ImageSequence::currentIndexChanged, this,
           &AppController::onCurrentImageChanged);
   connect(m_sequence, &ImageSequence::currentImageChanged, this,
           &AppController::onCurrentImageChanged);
-  connect(m_sequence, &ImageSequence::currentIndexChanged, this,
-          [this]() { emit currentIndexChanged(); });
+  connect(m_sequence, &ImageSequence::currentIndexChanged, this, [this]() {
+    emit currentIndexChanged();
+    emit currentMarkersChanged();
+  });
   connect(m_sequence, &ImageSequence::countChanged, this, [this]() {
     emit frameCountChanged();
     emit titleChanged();
+    emit currentMarkersChanged();
+  });
+  connect(m_sequence, &ImageSequence::markersChanged, this, [this](int index) {
+    if (index == m_sequence->currentIndex())
+      emit currentMarkersChanged();
   });
   connect(m_sequence, &ImageSequence::imageModified, this,
           &AppController::onImageModified);
+  connect(m_sequence, &ImageSequence::loadingChanged, this,
+          &AppController::onLoadingChanged);
+  connect(m_sequence, &ImageSequence::loadProgress, this,
+          [this](int decoded, int total) {
+            setStatusMessage(
+                QString("Loading frames... %1/%2").arg(decoded).arg(total));
+          });
+  connect(m_sequence, &ImageSequence::saveProgress, this,
+          [this](int written, int total) {
+            setStatusMessage(
+                QString("Exporting frames... %1/%2").arg(written).arg(total));
+          });
+  connect(m_sequence, &ImageSequence::saveFinished, this,
+          &AppController::onSaveFinished);
+  connect(m_sequence, &ImageSequence::loadCanceled, this, [this]() {
+    setStatusMessage(QString("Loading canceled, kept %1 frames")
+                         .arg(m_sequence->count()));
+  });
+  connect(m_sequence, &ImageSequence::framesReloaded, this,
+          [this](const QList<int> &indices) {
+            setStatusMessage(indices.size() == 1
+                                 ? QString("Reloaded frame %1 from disk")
+                                       .arg(indices.first() + 1)
+                                 : QString("Reloaded %1 frames from disk")
+                                       .arg(indices.size()));
+          });
+
+  // Any edit of the swap table refreshes the preview
+  auto updateSwapPreview = [this]() {
+    m_swapPreview->setSwaps(m_colorSwapModel->getSwaps());
+  };
+  connect(m_colorSwapModel, &QAbstractItemModel::dataChanged, this,
+          updateSwapPreview);
+  connect(m_colorSwapModel, &QAbstractItemModel::rowsInserted, this,
+          updateSwapPreview);
+  connect(m_colorSwapModel, &QAbstractItemModel::rowsRemoved, this,
+          updateSwapPreview);
+  connect(m_colorSwapModel, &QAbstractItemModel::modelReset, this,
+          updateSwapPreview);
+  connect(m_colorSwapModel, &ColorSwapModel::metricChanged, this,
+          updateSwapPreview);
+  connect(m_swapPreview, &SwapPreview::previewChanged, this, [this]() {
+    emit swapPreviewChanged();
+    emit requestImageRefresh();
+  });
+
+  connect(m_sequence, &ImageSequence::reloadConflict, this,
+          [this](int index, const QString &) {
+            setStatusMessage(
+                QString("Frame %1 changed on disk but has unsaved edits; "
+                        "kept your edits")
+                    .arg(index + 1));
+          });
 }
 
 QString AppController::currentTitle() const {
@@ -63,6 +128,8 @@ int AppController::currentIndex() const { return m_sequence->currentIndex(); }
 
 int AppController::frameCount() const { return m_sequence->count(); }
 
+bool AppController::isLoading() const { return m_sequence->isLoading(); }
+
 double AppController::zoomLevel() const { return m_zoomLevel; }
 
 void AppController::setCurrentIndex(int index) {
@@ -76,6 +143,70 @@ void AppController::setZoomLevel(double level) {
   emit zoomLevelChanged();
 }
 
+int AppController::frameCacheBudgetMB() const {
+  return int(m_sequence->frameCacheBudget() / (1024 * 1024));
+}
+
+void AppController::setFrameCacheBudgetMB(int megabytes) {
+  if (megabytes < 0 || megabytes == frameCacheBudgetMB())
+    return;
+  m_sequence->setFrameCacheBudget(qint64(megabytes) * 1024 * 1024);
+  emit frameCacheBudgetChanged();
+}
+
+int AppController::undoBudgetMB() const {
+  return int(m_undoBudget / (1024 * 1024));
+}
+
+void AppController::setUndoBudgetMB(int megabytes) {
+  if (megabytes < 0 || megabytes == undoBudgetMB())
+    return;
+  m_undoBudget = qint64(megabytes) * 1024 * 1024;
+  trimUndoHistory();
+  emit undoBudgetChanged();
+}
+
+bool AppController::indexedStorage() const {
+  return m_sequence->indexedStorage();
+}
+
+void AppController::setIndexedStorage(bool enabled) {
+  if (enabled == indexedStorage())
+    return;
+  m_sequence->setIndexedStorage(enabled);
+  emit indexedStorageChanged();
+}
+
+bool AppController::sequenceCacheEnabled() const {
+  return m_sequence->sequenceCacheEnabled();
+}
+
+void AppController::setSequenceCacheEnabled(bool enabled) {
+  if (enabled == sequenceCacheEnabled())
+    return;
+  m_sequence->setSequenceCacheEnabled(enabled);
+  emit sequenceCacheEnabledChanged();
+}
+
+bool AppController::swapPreviewEnabled() const {
+  return m_swapPreview->isEnabled();
+}
+
+bool AppController::swapPreviewActive() const {
+  return m_swapPreview->hasPreview();
+}
+
+SwapPreview *AppController::swapPreview() const { return m_swapPreview; }
+
+void AppController::setSwapPreviewEnabled(bool enabled) {
+  if (enabled == swapPreviewEnabled())
+    return;
+  if (enabled)
+    m_swapPreview->setSwaps(m_colorSwapModel->getSwaps());
+  m_swapPreview->setEnabled(enabled);
+  emit swapPreviewEnabledChanged();
+}
+
 void AppController::quitApp() {
     qDebug() << "AppController requesting quit.";
     QCoreApplication::exit(0);
@@ -93,6 +224,8 @@ void AppController::openSequence(const QList<QUrl> &urls) {
   m_sequence->loadSequence(paths);
 }
 
+void AppController::cancelLoading() { m_sequence->cancelLoading(); }
+
 void AppController::openFolderPicker() {
   QStringList dirs;
 
@@ -138,9 +271,7 @@ void AppController::openFolderPicker() {
   if (dirs.isEmpty())
     return;
 
-  QStringList imageFilters;
-  imageFilters << "*.png" << "*.jpg" << "*.jpeg" << "*.bmp"
-               << "*.tga" << "*.targa" << "*.tif" << "*.tiff";
+  const QStringList imageFilters = ImageSequence::imageNameFilters();
 
   QStringList allPaths;
   for (const QString &dirPath : dirs) {
@@ -163,16 +294,30 @@ void AppController::openFolderPicker() {
   m_sequence->loadSequence(allPaths);
 }
 
-bool AppController::saveSequence(const QUrl &folderUrl) {
+bool AppController::saveSequence(const QUrl &folderUrl, bool modifiedOnly) {
   if (m_sequence->count() == 0)
     return false;
 
+  if (m_sequence->isSaving()) {
+    setStatusMessage("An export is already in progress.");
+    return false;
+  }
+
+  if (modifiedOnly && m_sequence->modifiedCount() == 0) {
+    setStatusMessage("No modified frames to export.");
+    return false;
+  }
+
   QString folderPath = folderUrl.toLocalFile();
-  m_sequence->saveSequence(folderPath);
-  setStatusMessage("Sequence exported successfully.");
+  m_sequence->saveSequence(folderPath, QString(), modifiedOnly);
   return true;
 }
 
+QList<int> AppController::framesUsingColor(const QColor &color,
+                                           int tolerance) const {
+  return m_sequence->framesUsingColor(color.rgba(), tolerance);
+}
+
 void AppController::pickColorAt(int x, int y) {
   if (m_sequence) {
     if (x >= 0 && x < m_sequence->currentImage().width() && y >= 0 &&
@@ -211,6 +356,9 @@ void AppController::applyColorReplacement(bool allFrames) {
   if (swaps.isEmpty()) return;
 
   m_undoStack->push(new ColorSwapCommand(m_sequence, swaps, allFrames));
+
+  // The committed frame replaces the preview
+  setSwapPreviewEnabled(false);
 }
 
 GuideCheckModel *AppController::guideCheckModel() const {
@@ -234,7 +382,7 @@ void AppController::applyGuideCheck(bool allFrames, int radius, int thickness) {
   }
 
   m_undoStack->push(new GuideCheckCommand(m_sequence, params, allFrames));
-  setStatusMessage(allFrames ? "Applied guide checks to all frames." : "Applied guide checks to current frame.");
+  setStatusMessage(allFrames ? "Marked guide checks on all frames." : "Marked guide checks on current frame.");
 }
 
 void AppController::applyAlphaCheck(bool allFrames, const QColor &color,
@@ -249,7 +397,125 @@ void AppController::applyAlphaCheck(bool allFrames, const QColor &color,
   params.applyToAll = allFrames;
 
   m_undoStack->push(new AlphaCheckCommand(m_sequence, params, allFrames));
-  setStatusMessage(allFrames ? "Applied alpha check to all frames." : "Applied alpha check to current frame.");
+  setStatusMessage(allFrames ? "Marked alpha check on all frames." : "Marked alpha check on current frame.");
+}
+
+void AppController::cleanupSpecks(bool allFrames, int maxArea, bool absorb,
+                                  const QColor &markerColor) {
+  if (!m_sequence)
+    return;
+
+  SpeckCleanupParams params;
+  params.maxArea = maxArea;
+  params.absorb = absorb;
+  params.markerColor = markerColor;
+
+  m_undoStack->push(new SpeckCleanupCommand(m_sequence, params, allFrames));
+  if (absorb)
+    setStatusMessage(allFrames ? "Cleaned up specks on all frames." : "Cleaned up specks on current frame.");
+  else
+    setStatusMessage(allFrames ? "Marked specks on all frames." : "Marked specks on current frame.");
+}
+
+void AppController::propagateColors(int lastFrame, const QColor &lineColor,
+                                    int lineTolerance,
+                                    const QColor &markerColor) {
+  if (!m_sequence)
+    return;
+
+  PropagationParams params;
+  params.keyFrame = m_sequence->currentIndex();
+  params.lastFrame = lastFrame < 0 ? m_sequence->count() - 1 : lastFrame;
+  params.lineColor = lineColor;
+  params.lineTolerance = lineTolerance;
+  params.markerColor = markerColor;
+  if (params.keyFrame < 0 || params.lastFrame <= params.keyFrame) {
+    setStatusMessage("No following frames to propagate to.");
+    return;
+  }
+
+  m_undoStack->push(new PropagateColorsCommand(m_sequence, params));
+
+  int flagged = 0;
+  for (int i = params.keyFrame + 1; i <= params.lastFrame; ++i) {
+    for (const QcMarker &marker : m_sequence->markers(i))
+      flagged += marker.kind == QcMarker::ReviewCircle;
+  }
+  setStatusMessage(QString("Propagated colors to frames %1-%2; %3 regions to "
+                           "review.")
+                       .arg(params.keyFrame + 2)
+                       .arg(params.lastFrame + 1)
+                       .arg(flagged));
+}
+
+void AppController::bucketFill(int x, int y, const QColor &color,
+                               int tolerance, int gapClose, int firstFrame,
+                               int lastFrame) {
+  if (!m_sequence || m_sequence->count() == 0)
+    return;
+
+  const int current = m_sequence->currentIndex();
+  if (firstFrame < 0)
+    firstFrame = current;
+  if (lastFrame < 0)
+    lastFrame = current;
+  if (lastFrame < firstFrame)
+    std::swap(firstFrame, lastFrame);
+
+  FillParams params;
+  params.seed = QPoint(x, y);
+  params.fillColor = color;
+  params.tolerance = tolerance;
+  params.gapClose = gapClose;
+
+  // Fills that change nothing are dropped by the stack
+  const int index = m_undoStack->index();
+  m_undoStack->push(new FillCommand(m_sequence, params, firstFrame, lastFrame));
+  if (m_undoStack->index() == index) {
+    setStatusMessage("Nothing to fill.");
+    return;
+  }
+  setStatusMessage(firstFrame == lastFrame
+                       ? QString("Filled region on frame %1.").arg(firstFrame + 1)
+                       : QString("Filled region on frames %1-%2.")
+                             .arg(firstFrame + 1)
+                             .arg(lastFrame + 1));
+}
+
+void AppController::clearMarkers(bool allFrames) {
+  if (!m_sequence)
+    return;
+
+  bool any = false;
+  for (int i = 0; i < m_sequence->count() && !any; ++i) {
+    if (allFrames || i == m_sequence->currentIndex())
+      any = !m_sequence->markers(i).isEmpty();
+  }
+  if (!any) {
+    setStatusMessage("No QC markers to clear.");
+    return;
+  }
+
+  m_undoStack->push(new ClearMarkersCommand(m_sequence, allFrames));
+  setStatusMessage(allFrames ? "Cleared QC markers on all frames." : "Cleared QC markers on current frame.");
+}
+
+QVariantList AppController::currentMarkers() const {
+  QVariantList result;
+  if (!m_sequence)
+    return result;
+
+  for (const QcMarker &marker : m_sequence->markers(m_sequence->currentIndex())) {
+    QVariantMap item;
+    item["kind"] = marker.kind == QcMarker::AlphaCross ? "cross" : "circle";
+    item["x"] = marker.center.x();
+    item["y"] = marker.center.y();
+    item["size"] = marker.size;
+    item["thickness"] = marker.thickness;
+    item["color"] = marker.color;
+    result.append(item);
+  }
+  return result;
 }
 
 void AppController::addCustomColor(const QColor &color) {
@@ -265,26 +531,78 @@ void AppController::addCustomColor(const QColor &color) {
 
 QList<QColor> AppController::customColors() const { return m_customColors; }
 
+// All commands on the stack are HistoryCommands; the stack only hands out
+// const pointers, but expiring one leaves what undo() sees consistent
+static HistoryCommand *historyCommand(const QUndoStack *stack, int index) {
+  return const_cast<HistoryCommand *>(
+      dynamic_cast<const HistoryCommand *>(stack->command(index)));
+}
+
+// Status for an undo or redo step, noting frames it had to leave alone
+static QString historyStatus(const QString &action, const QString &text,
+                             const HistoryCommand *command) {
+  const int skipped = command ? command->skippedFrames() : 0;
+  if (skipped == 0)
+    return QString("%1: %2").arg(action, text);
+  return QString("%1: %2; %3 frames changed on disk were left alone")
+      .arg(action, text)
+      .arg(skipped);
+}
+
 void AppController::undo() {
-    if (m_undoStack->canUndo()) {
+    if (canUndo()) {
         QString text = m_undoStack->undoText();
         m_undoStack->undo();
-        setStatusMessage(QString("Undo: %1").arg(text));
+        setStatusMessage(historyStatus(
+            "Undo", text, historyCommand(m_undoStack, m_undoStack->index())));
     }
 }
 
 void AppController::redo() {
-    if (m_undoStack->canRedo()) {
+    if (canRedo()) {
         QString text = m_undoStack->redoText();
         m_undoStack->redo();
-        setStatusMessage(QString("Redo: %1").arg(text));
+        setStatusMessage(historyStatus(
+            "Redo", text,
+            historyCommand(m_undoStack, m_undoStack->index() - 1)));
     }
 }
-bool AppController::canUndo() const { return m_undoStack->canUndo(); }
+bool AppController::canUndo() const {
+  if (!m_undoStack->canUndo())
+    return false;
+  const HistoryCommand *command =
+      historyCommand(m_undoStack, m_undoStack->index() - 1);
+  return !command || !command->isExpired();
+}
 bool AppController::canRedo() const { return m_undoStack->canRedo(); }
 
+// Expires the oldest undoable steps until the history fits the budget. The
+// step that would be undone next is always kept, even alone over budget.
+// QUndoStack cannot drop commands from the bottom of a non-empty stack, so
+// expired ones stay as empty entries that canUndo() stops at.
+void AppController::trimUndoHistory() {
+  if (m_undoBudget <= 0)
+    return;
+
+  qint64 total = 0;
+  bool expired = false;
+  for (int i = 0; i < m_undoStack->count(); ++i) {
+    if (const HistoryCommand *command = historyCommand(m_undoStack, i))
+      total += command->byteCost();
+  }
+  for (int i = 0; i + 1 < m_undoStack->index() && total > m_undoBudget; ++i) {
+    HistoryCommand *command = historyCommand(m_undoStack, i);
+    if (!command || command->isExpired())
+      continue;
+    total -= command->byteCost();
+    command->expire();
+    expired = true;
+  }
+  if (expired)
+    emit undoStateChanged();
+}
+
 void AppController::onSequenceLoaded() {
-  m_undoStack->clear();
   setStatusMessage(QString("Loaded %1 frames").arg(m_sequence->count()));
   m_zoomLevel = 1.0;
   emit zoomLevelChanged();
@@ -292,6 +610,39 @@ void AppController::onSequenceLoaded() {
   emit requestImageRefresh();
 }
 
+void AppController::onLoadingChanged() {
+  // Reset history when a new load starts; frames can already be edited while
+  // the rest of the sequence is still decoding.
+  if (m_sequence->isLoading())
+    m_undoStack->clear();
+  emit loadingChanged();
+}
+
+void AppController::onSaveFinished(int written,
+                                   const QStringList &failedPaths) {
+  if (failedPaths.isEmpty()) {
+    QString msg = QString("Exported %1 frames.").arg(written);
+    setStatusMessage(msg);
+    emit exportFinished(true, msg);
+    return;
+  }
+
+  QStringList names;
+  for (const QString &path : failedPaths.mid(0, 5)) {
+    names.append(QFileInfo(path).fileName());
+  }
+  if (failedPaths.size() > names.size())
+    names.append("...");
+
+  QString msg = QString("Exported %1 frames, %2 failed:\n%3")
+                    .arg(written)
+                    .arg(failedPaths.size())
+                    .arg(names.join("\n"));
+  setStatusMessage(QString("Export failed for %1 frames.")
+                       .arg(failedPaths.size()));
+  emit exportFinished(false, msg);
+}
+
 void AppController::onCurrentImageChanged() {
   emit titleChanged();
   emit requestImageRefresh();
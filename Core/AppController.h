@@ -3,6 +3,7 @@
 
 #include "ColorSwapModel.h"
 #include "GuideCheckModel.h"
+#include "SwapPreview.h"
 #include "TimelineModel.h"
 #include <QGuiApplication>
 #include <QList>
@@ -10,6 +11,7 @@
 #include <QScreen>
 #include <QUrl>
 #include <QUndoStack>
+#include <QVariantList>
 #include <QtGui/QColor>
 
 class ImageSequence;
@@ -25,10 +27,27 @@ class AppController : public QObject {
   Q_PROPERTY(int currentIndex READ currentIndex WRITE setCurrentIndex NOTIFY
                  currentIndexChanged)
   Q_PROPERTY(int frameCount READ frameCount NOTIFY frameCountChanged)
+  Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
   Q_PROPERTY(double zoomLevel READ zoomLevel WRITE setZoomLevel NOTIFY
                  zoomLevelChanged)
+  Q_PROPERTY(int frameCacheBudgetMB READ frameCacheBudgetMB WRITE
+                 setFrameCacheBudgetMB NOTIFY frameCacheBudgetChanged)
+  Q_PROPERTY(int undoBudgetMB READ undoBudgetMB WRITE setUndoBudgetMB NOTIFY
+                 undoBudgetChanged)
+  Q_PROPERTY(bool indexedStorage READ indexedStorage WRITE setIndexedStorage
+                 NOTIFY indexedStorageChanged)
+  Q_PROPERTY(bool sequenceCacheEnabled READ sequenceCacheEnabled WRITE
+                 setSequenceCacheEnabled NOTIFY sequenceCacheEnabledChanged)
+  Q_PROPERTY(bool swapPreviewEnabled READ swapPreviewEnabled WRITE
+                 setSwapPreviewEnabled NOTIFY swapPreviewEnabledChanged)
+  Q_PROPERTY(bool swapPreviewActive READ swapPreviewActive NOTIFY
+                 swapPreviewChanged)
   Q_PROPERTY(
       QList<QColor> customColors READ customColors NOTIFY customColorsChanged)
+  Q_PROPERTY(bool canUndo READ canUndo NOTIFY undoStateChanged)
+  Q_PROPERTY(bool canRedo READ canRedo NOTIFY undoStateChanged)
+  Q_PROPERTY(QVariantList currentMarkers READ currentMarkers NOTIFY
+                 currentMarkersChanged)
 
 public:
   explicit AppController(ImageSequence *sequence, QObject *parent = nullptr);
@@ -41,21 +60,49 @@ public:
   TimelineModel *timelineModel() const;
   int currentIndex() const;
   int frameCount() const;
+  bool isLoading() const;
   double zoomLevel() const;
+  int frameCacheBudgetMB() const;
+  int undoBudgetMB() const;
+  bool indexedStorage() const;
+  bool sequenceCacheEnabled() const;
+  bool swapPreviewEnabled() const;
+  bool swapPreviewActive() const;
+  SwapPreview *swapPreview() const;
+  // QC markers of the current frame as maps of kind ("circle" or "cross"),
+  // x, y, size, thickness and color, for the canvas overlay
+  QVariantList currentMarkers() const;
 
   // Property setters (Q_INVOKABLE for direct QML calls)
   Q_INVOKABLE void setCurrentIndex(int index);
   Q_INVOKABLE void setZoomLevel(double level);
+  // 0 keeps all frames resident; applies to the next opened sequence
+  Q_INVOKABLE void setFrameCacheBudgetMB(int megabytes);
+  // Undo history kept within this size by expiring the oldest steps; 0 keeps
+  // all history
+  Q_INVOKABLE void setUndoBudgetMB(int megabytes);
+  // Palette-indexed frames; applies to the next opened sequence
+  Q_INVOKABLE void setIndexedStorage(bool enabled);
+  // Sidecar cache of decoded frames for fast reopen
+  Q_INVOKABLE void setSequenceCacheEnabled(bool enabled);
+  // Live preview of the swap table on the current frame until applied
+  Q_INVOKABLE void setSwapPreviewEnabled(bool enabled);
   
   Q_INVOKABLE void quitApp();
 
   // QML invokable methods
   Q_INVOKABLE void openSequence(const QList<QUrl> &urls);
   Q_INVOKABLE void openFolderPicker();
-  Q_INVOKABLE bool saveSequence(const QUrl &folderUrl);
+  Q_INVOKABLE void cancelLoading();
+  // Starts an export; exportFinished() reports the outcome
+  Q_INVOKABLE bool saveSequence(const QUrl &folderUrl,
+                                bool modifiedOnly = false);
   Q_INVOKABLE void pickColorAt(int x, int y);
   Q_INVOKABLE QColor pickScreenColor(int x, int y);
   Q_INVOKABLE void applyColorReplacement(bool allFrames);
+  // Zero-based indices of frames using a colour, e.g. to jump to its uses
+  Q_INVOKABLE QList<int> framesUsingColor(const QColor &color,
+                                          int tolerance = 0) const;
 
   // Guide Color Feature
   Q_INVOKABLE void applyGuideCheck(bool allFrames, int radius, int thickness);
@@ -63,15 +110,34 @@ public:
   // Alpha Check Feature
   Q_INVOKABLE void applyAlphaCheck(bool allFrames, const QColor &color,
                                    int size, int thickness);
+  Q_INVOKABLE void clearMarkers(bool allFrames);
+
+  // Speck Cleanup Feature: regions of at most maxArea pixels, marked or
+  // absorbed into their dominant neighbouring colour
+  Q_INVOKABLE void cleanupSpecks(bool allFrames, int maxArea, bool absorb,
+                                 const QColor &markerColor);
+
+  // Color Propagation Feature: colours of the current frame's regions carried
+  // to the matching regions of the following frames up to lastFrame (-1 for
+  // all); unmatched regions get review markers
+  Q_INVOKABLE void propagateColors(int lastFrame, const QColor &lineColor,
+                                   int lineTolerance,
+                                   const QColor &markerColor);
+
+  // Bucket Fill Feature: the region under (x, y) in frames firstFrame to
+  // lastFrame; -1 for either means the current frame
+  Q_INVOKABLE void bucketFill(int x, int y, const QColor &color, int tolerance,
+                              int gapClose, int firstFrame = -1,
+                              int lastFrame = -1);
 
   Q_INVOKABLE void addCustomColor(const QColor &color);
   QList<QColor> customColors() const;
 
-  // Undo/Redo
+  // Undo/Redo; steps expired by the undo budget cannot be undone
   Q_INVOKABLE void undo();
   Q_INVOKABLE void redo();
-  Q_INVOKABLE bool canUndo() const;
-  Q_INVOKABLE bool canRedo() const;
+  bool canUndo() const;
+  bool canRedo() const;
 
 signals:
   void titleChanged();
@@ -79,16 +145,29 @@ signals:
   void customColorsChanged();
   void currentIndexChanged();
   void frameCountChanged();
+  void loadingChanged();
   void zoomLevelChanged();
+  void frameCacheBudgetChanged();
+  void undoBudgetChanged();
+  void undoStateChanged();
+  void indexedStorageChanged();
+  void sequenceCacheEnabledChanged();
+  void swapPreviewEnabledChanged();
+  void swapPreviewChanged();
+  void currentMarkersChanged();
   void requestImageRefresh();
+  void exportFinished(bool success, const QString &message);
 
 private slots:
   void onSequenceLoaded();
+  void onLoadingChanged();
   void onCurrentImageChanged();
   void onImageModified(int index);
+  void onSaveFinished(int written, const QStringList &failedPaths);
 
 private:
   void setStatusMessage(const QString &msg);
+  void trimUndoHistory();
 
   ImageSequence *m_sequence;
   ColorSwapModel *m_colorSwapModel;
@@ -98,6 +177,8 @@ private:
   double m_zoomLevel = 1.0;
   QList<QColor> m_customColors;
   QUndoStack *m_undoStack;
+  qint64 m_undoBudget = qint64(1024) * 1024 * 1024;
+  SwapPreview *m_swapPreview;
 };
 
 #endif // APPCONTROLLER_H
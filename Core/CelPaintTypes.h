@@ -1,13 +1,26 @@
 #ifndef CELPAINTTYPES_H
 #define CELPAINTTYPES_H
 
+#include <QImage>
+#include <QPoint>
+#include <QRect>
 #include <QtGui/QColor>
 
+// How a tolerance is measured between two colours. Alpha always uses the
+// plain channel difference except for Premultiplied.
+enum class ColorMetric {
+  PerChannel,   // Every RGBA channel within tolerance (box test)
+  EuclideanRgb, // RGB distance within tolerance
+  CieLab,       // CIE76 delta E within tolerance
+  Premultiplied // RGBA distance of alpha-premultiplied values
+};
+
 struct ColorSwap {
   QColor source;
   QColor dest;
   bool enabled = true;
   int tolerance = 0;
+  ColorMetric metric = ColorMetric::PerChannel;
 };
 
 struct GuideColorParams {
@@ -17,6 +30,7 @@ struct GuideColorParams {
   int thickness = 2;
   int tolerance = 0;
   bool enabled = true;
+  ColorMetric metric = ColorMetric::PerChannel;
 };
 
 struct AlphaCheckParams {
@@ -26,4 +40,52 @@ struct AlphaCheckParams {
   bool applyToAll = false;
 };
 
+struct SpeckCleanupParams {
+  // Upper bound for maxArea; absorbing walks each speck pixel by pixel
+  static constexpr int MaxArea = 256;
+
+  int maxArea = 5;     // Regions of one colour up to this many pixels are specks
+  bool absorb = false; // Fill with the dominant neighbouring colour, else mark
+  QColor markerColor = Qt::magenta;
+  int markerRadius = 8;
+  int thickness = 2;
+};
+
+struct FillParams {
+  QPoint seed; // The region under this pixel is filled
+  QColor fillColor;
+  int tolerance = 0; // Against the seed pixel's colour
+  ColorMetric metric = ColorMetric::PerChannel;
+  int gapClose = 0; // Boundary gaps up to twice this wide are closed
+};
+
+struct PropagationParams {
+  int keyFrame = 0;   // Painted frame the colours come from
+  int lastFrame = -1; // Last frame to colour; -1 for the end of the sequence
+  QColor lineColor = Qt::black;
+  int lineTolerance = 64; // Pixels this close to lineColor are line art
+  int minArea = 16;       // Smaller regions are left alone
+  double maxCost = 1.0;   // Worst match accepted, see RegionMatcher
+  QColor markerColor = Qt::yellow;
+  int markerRadius = 10;
+  int thickness = 2;
+};
+
+// Pixels of part of a frame, so local edits undo without a whole frame
+struct FramePatch {
+  QRect rect;
+  QImage image; // ARGB32, rect.size()
+};
+
+// Non-destructive QC annotation shown over a frame instead of painted into it
+struct QcMarker {
+  enum Kind { GuideCircle, AlphaCross, SpeckCircle, ReviewCircle };
+
+  Kind kind = GuideCircle;
+  QPoint center;
+  int size = 10; // Circle radius, or cross width and height
+  int thickness = 2;
+  QColor color;
+};
+
 #endif // CORE_TYPES_H
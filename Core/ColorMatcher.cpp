@@ -0,0 +1,127 @@
+#include "ColorMatcher.h"
+#include <QtGlobal>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const int LabBits = 6;
+const int LabSide = 1 << LabBits;
+
+float srgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float labF(float t) {
+  const float delta = 6.0f / 29.0f;
+  return t > delta * delta * delta ? std::cbrt(t)
+                                   : t / (3 * delta * delta) + 4.0f / 29.0f;
+}
+
+// sRGB (D65) to CIE Lab for every quantized cell, sampled at the cell centre
+const std::vector<float> &labTable() {
+  static const std::vector<float> table = []() {
+    std::vector<float> lab(size_t(LabSide) * LabSide * LabSide * 3);
+    const float step = 256.0f / LabSide;
+    float linear[LabSide];
+    for (int i = 0; i < LabSide; ++i)
+      linear[i] = srgbToLinear((i * step + step / 2) / 255.0f);
+
+    float *out = lab.data();
+    for (int r = 0; r < LabSide; ++r) {
+      for (int g = 0; g < LabSide; ++g) {
+        for (int b = 0; b < LabSide; ++b) {
+          const float lr = linear[r], lg = linear[g], lb = linear[b];
+          const float x = (0.4124564f * lr + 0.3575761f * lg + 0.1804375f * lb) /
+                          0.95047f;
+          const float y = 0.2126729f * lr + 0.7151522f * lg + 0.0721750f * lb;
+          const float z = (0.0193339f * lr + 0.1191920f * lg + 0.9503041f * lb) /
+                          1.08883f;
+          const float fx = labF(x), fy = labF(y), fz = labF(z);
+          *out++ = 116 * fy - 16;
+          *out++ = 500 * (fx - fy);
+          *out++ = 200 * (fy - fz);
+        }
+      }
+    }
+    return lab;
+  }();
+  return table;
+}
+
+inline const float *labOf(QRgb color) {
+  const int shift = 8 - LabBits;
+  const size_t cell = (size_t(qRed(color) >> shift) << (2 * LabBits)) |
+                      (size_t(qGreen(color) >> shift) << LabBits) |
+                      size_t(qBlue(color) >> shift);
+  return labTable().data() + cell * 3;
+}
+
+inline int premultiply(int channel, int alpha) {
+  return (channel * alpha + 127) / 255;
+}
+
+} // namespace
+
+ColorMatcher::ColorMatcher(QRgb reference, int tolerance, ColorMetric metric)
+    : m_reference(reference), m_tolerance(tolerance), m_metric(metric),
+      m_limit(tolerance * tolerance) {
+  if (m_metric == ColorMetric::CieLab) {
+    const float *lab = labOf(reference);
+    m_lab[0] = lab[0];
+    m_lab[1] = lab[1];
+    m_lab[2] = lab[2];
+  } else if (m_metric == ColorMetric::Premultiplied) {
+    const int a = qAlpha(reference);
+    m_premultiplied[0] = premultiply(qRed(reference), a);
+    m_premultiplied[1] = premultiply(qGreen(reference), a);
+    m_premultiplied[2] = premultiply(qBlue(reference), a);
+    m_premultiplied[3] = a;
+  }
+}
+
+bool ColorMatcher::isBox() const {
+  return m_metric == ColorMetric::PerChannel || m_tolerance <= 0;
+}
+
+bool ColorMatcher::matches(QRgb color) const {
+  if (m_tolerance <= 0)
+    return m_tolerance == 0 && color == m_reference;
+
+  const int da = qAlpha(color) - qAlpha(m_reference);
+  switch (m_metric) {
+  case ColorMetric::PerChannel:
+    return qAbs(qRed(color) - qRed(m_reference)) <= m_tolerance &&
+           qAbs(qGreen(color) - qGreen(m_reference)) <= m_tolerance &&
+           qAbs(qBlue(color) - qBlue(m_reference)) <= m_tolerance &&
+           qAbs(da) <= m_tolerance;
+
+  case ColorMetric::EuclideanRgb: {
+    if (qAbs(da) > m_tolerance)
+      return false;
+    const int dr = qRed(color) - qRed(m_reference);
+    const int dg = qGreen(color) - qGreen(m_reference);
+    const int db = qBlue(color) - qBlue(m_reference);
+    return dr * dr + dg * dg + db * db <= m_limit;
+  }
+
+  case ColorMetric::CieLab: {
+    if (qAbs(da) > m_tolerance)
+      return false;
+    const float *lab = labOf(color);
+    const float dl = lab[0] - m_lab[0];
+    const float dA = lab[1] - m_lab[1];
+    const float dB = lab[2] - m_lab[2];
+    return dl * dl + dA * dA + dB * dB <= float(m_limit);
+  }
+
+  case ColorMetric::Premultiplied: {
+    const int a = qAlpha(color);
+    const int dr = premultiply(qRed(color), a) - m_premultiplied[0];
+    const int dg = premultiply(qGreen(color), a) - m_premultiplied[1];
+    const int db = premultiply(qBlue(color), a) - m_premultiplied[2];
+    return dr * dr + dg * dg + db * db + da * da <= m_limit;
+  }
+  }
+  return false;
+}
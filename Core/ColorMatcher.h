@@ -0,0 +1,34 @@
+#ifndef COLORMATCHER_H
+#define COLORMATCHER_H
+
+#include "CelPaintTypes.h"
+#include <QtGui/QRgb>
+
+// Tolerance test against one reference colour under a ColorMetric.
+//
+// Everything that does not depend on the pixel is prepared in the
+// constructor. CIE Lab values come from a 64x64x64 table quantized on the
+// top six bits of each channel, built once per process, so a Lab test costs
+// one lookup and a few multiplies. A tolerance of 0 is exact equality under
+// every metric.
+class ColorMatcher {
+public:
+  ColorMatcher() = default; // Matches nothing
+  ColorMatcher(QRgb reference, int tolerance, ColorMetric metric);
+
+  bool matches(QRgb color) const;
+
+  // True when the test is the plain per-channel box, which the vectorized
+  // and indexed swap paths implement directly
+  bool isBox() const;
+
+private:
+  QRgb m_reference = 0;
+  int m_tolerance = -1;
+  ColorMetric m_metric = ColorMetric::PerChannel;
+  int m_limit = 0; // Squared tolerance
+  float m_lab[3] = {0, 0, 0};
+  int m_premultiplied[4] = {0, 0, 0, 0};
+};
+
+#endif // COLORMATCHER_H
@@ -0,0 +1,165 @@
+#include "ColorPresence.h"
+#include "ColorMatcher.h"
+#include <QSet>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Beyond this many colours the exact set gives way to the Bloom filter
+const int ExactLimit = 1024;
+const int BloomBits = 1 << 15; // 4 KiB per frame
+
+inline quint64 bloomHash(QRgb color) {
+  return quint64(color) * 0x9e3779b97f4a7c15ull;
+}
+
+inline quint32 channelMin(quint32 a, quint32 b) {
+  quint32 result = 0;
+  for (int shift = 0; shift < 32; shift += 8)
+    result |= qMin((a >> shift) & 0xff, (b >> shift) & 0xff) << shift;
+  return result;
+}
+
+inline quint32 channelMax(quint32 a, quint32 b) {
+  quint32 result = 0;
+  for (int shift = 0; shift < 32; shift += 8)
+    result |= qMax((a >> shift) & 0xff, (b >> shift) & 0xff) << shift;
+  return result;
+}
+
+} // namespace
+
+ColorPresence ColorPresence::fromImage(const QImage &image) {
+  ColorPresence presence;
+  if (image.isNull())
+    return presence;
+
+  QSet<QRgb> colors;
+  auto add = [&](QRgb color) {
+    if (presence.m_exact) {
+      colors.insert(color);
+      if (colors.size() > ExactLimit) {
+        presence.m_exact = false;
+        presence.m_bloom.fill(0, BloomBits / 64);
+        for (QRgb c : std::as_const(colors))
+          presence.addToBloom(c);
+        colors.clear();
+      }
+    } else {
+      presence.addToBloom(color);
+    }
+    presence.m_min = channelMin(presence.m_min, color);
+    presence.m_max = channelMax(presence.m_max, color);
+  };
+
+  presence.m_valid = true;
+  presence.m_exact = true;
+  presence.m_min = 0xffffffffu;
+
+  // Indexed frames only carry the colours they use
+  if (image.format() == QImage::Format_Indexed8) {
+    for (QRgb color : image.colorTable())
+      add(color);
+  } else {
+    const QImage argb = image.format() == QImage::Format_ARGB32
+                            ? image
+                            : image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < argb.height(); ++y) {
+      const QRgb *line = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+      QRgb last = line[0];
+      add(last);
+      for (int x = 1; x < argb.width(); ++x) {
+        // Flat areas repeat the previous pixel; skip the set lookup
+        if (line[x] != last) {
+          last = line[x];
+          add(last);
+        }
+      }
+    }
+  }
+
+  if (presence.m_exact) {
+    presence.m_colors = QVector<QRgb>(colors.cbegin(), colors.cend());
+    std::sort(presence.m_colors.begin(), presence.m_colors.end());
+  }
+  return presence;
+}
+
+bool ColorPresence::isValid() const { return m_valid; }
+
+bool ColorPresence::isExact() const { return m_valid && m_exact; }
+
+bool ColorPresence::mayContain(QRgb color) const {
+  if (!m_valid)
+    return true;
+  if (channelMin(color, m_min) != m_min || channelMax(color, m_max) != m_max)
+    return false;
+
+  if (m_exact)
+    return std::binary_search(m_colors.cbegin(), m_colors.cend(), color);
+
+  const quint64 hash = bloomHash(color);
+  const quint32 a = quint32(hash >> 49);
+  const quint32 b = quint32(hash >> 34) & (BloomBits - 1);
+  return (m_bloom[a / 64] >> (a % 64) & 1) && (m_bloom[b / 64] >> (b % 64) & 1);
+}
+
+bool ColorPresence::mayContainNear(QRgb color, int tolerance) const {
+  if (tolerance < 0)
+    return false;
+  if (tolerance == 0)
+    return mayContain(color);
+  if (!m_valid)
+    return true;
+
+  for (int shift = 0; shift < 32; shift += 8) {
+    const int value = int((color >> shift) & 0xff);
+    if (value + tolerance < int((m_min >> shift) & 0xff) ||
+        value - tolerance > int((m_max >> shift) & 0xff))
+      return false;
+  }
+  if (!m_exact)
+    return true;
+
+  for (QRgb used : m_colors) {
+    if (qAbs(qRed(used) - qRed(color)) <= tolerance &&
+        qAbs(qGreen(used) - qGreen(color)) <= tolerance &&
+        qAbs(qBlue(used) - qBlue(color)) <= tolerance &&
+        qAbs(qAlpha(used) - qAlpha(color)) <= tolerance)
+      return true;
+  }
+  return false;
+}
+
+bool ColorPresence::mayContainNear(QRgb color, int tolerance,
+                                   ColorMetric metric) const {
+  if (metric == ColorMetric::PerChannel || tolerance <= 0)
+    return mayContainNear(color, tolerance);
+
+  // A Euclidean RGB match is also inside the box of the same size
+  if (metric == ColorMetric::EuclideanRgb &&
+      !mayContainNear(color, tolerance))
+    return false;
+  if (!isExact())
+    return true;
+
+  const ColorMatcher matcher(color, tolerance, metric);
+  for (QRgb used : m_colors) {
+    if (matcher.matches(used))
+      return true;
+  }
+  return false;
+}
+
+bool ColorPresence::mayContainTransparent() const {
+  return !m_valid || qAlpha(m_min) == 0;
+}
+
+void ColorPresence::addToBloom(QRgb color) {
+  const quint64 hash = bloomHash(color);
+  const quint32 a = quint32(hash >> 49);
+  const quint32 b = quint32(hash >> 34) & (BloomBits - 1);
+  m_bloom[a / 64] |= quint64(1) << (a % 64);
+  m_bloom[b / 64] |= quint64(1) << (b % 64);
+}
@@ -0,0 +1,46 @@
+#ifndef COLORPRESENCE_H
+#define COLORPRESENCE_H
+
+#include "CelPaintTypes.h"
+#include <QImage>
+#include <QVector>
+#include <QtGui/QRgb>
+
+// Summary of the colours a frame uses, so batch operations can skip frames
+// that cannot contain a source colour without touching their pixels.
+//
+// Frames with few colours (typical flat cel artwork) keep the exact sorted
+// colour set. Busier frames fall back to a Bloom filter, which can report
+// false positives but never false negatives. Both also keep per-channel
+// bounds, which refute tolerance matches the filter cannot answer.
+//
+// A default-constructed index is invalid and may contain anything.
+class ColorPresence {
+public:
+  static ColorPresence fromImage(const QImage &image);
+
+  bool isValid() const;
+  bool isExact() const;
+
+  // False only if no pixel can equal color
+  bool mayContain(QRgb color) const;
+  // False only if no pixel is within tolerance of color on every channel
+  bool mayContainNear(QRgb color, int tolerance) const;
+  // Same under any metric. Exact sets are tested colour by colour; otherwise
+  // only metrics bounded by the per-channel box can be refuted.
+  bool mayContainNear(QRgb color, int tolerance, ColorMetric metric) const;
+  // False only if every pixel is at least partly opaque
+  bool mayContainTransparent() const;
+
+private:
+  bool m_valid = false;
+  bool m_exact = false;
+  QVector<QRgb> m_colors; // Sorted; exact mode only
+  QVector<quint64> m_bloom;
+  quint32 m_min = 0; // Lowest value of each channel, one per byte
+  quint32 m_max = 0; // Highest value of each channel
+
+  void addToBloom(QRgb color);
+};
+
+#endif // COLORPRESENCE_H
@@ -0,0 +1,371 @@
+#include "ColorSwapKernel.h"
+#include "PixelSpans.h"
+#include <QtAlgorithms>
+#include <QtGlobal>
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||           \
+    defined(_M_IX86)
+#define CELPAINT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 for functions that ask for it; MSVC always can
+#if defined(CELPAINT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CELPAINT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CELPAINT_TARGET(isa)
+#endif
+
+namespace {
+
+// Above this many swaps, indexed lookup beats a vectorized linear scan
+const int LinearScanLimit = 16;
+
+// Runs at least this long are matched once and filled; shorter ones (noisy
+// scans, antialiased edges) go through the per-pixel kernel in batches
+const int MinFillRun = 8;
+
+// True if every channel of a is within the matching byte of tolerance of b
+inline bool channelsWithin(quint32 a, quint32 b, quint32 tolerance) {
+  if (tolerance == 0)
+    return a == b;
+  for (int shift = 0; shift < 32; shift += 8) {
+    const int diff =
+        std::abs(int((a >> shift) & 0xff) - int((b >> shift) & 0xff));
+    if (diff > int((tolerance >> shift) & 0xff))
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+ColorSwapKernel::ColorSwapKernel(const QList<ColorSwap> &swaps) {
+  for (const ColorSwap &swap : swaps) {
+    // A negative tolerance can never match
+    if (!swap.enabled || swap.tolerance < 0)
+      continue;
+
+    const quint32 tolerance = quint32(qMin(swap.tolerance, 255));
+    m_sources.append(swap.source.rgba());
+    m_dests.append(swap.dest.rgba());
+    m_tolerances.append(tolerance * 0x01010101u);
+
+    m_matchers.append(
+        ColorMatcher(swap.source.rgba(), swap.tolerance, swap.metric));
+    m_generic |= !m_matchers.last().isBox();
+  }
+
+  if (!m_generic && m_sources.size() > LinearScanLimit)
+    buildIndex();
+}
+
+void ColorSwapKernel::buildIndex() {
+  m_indexed = true;
+
+  // Exact swaps: power-of-two table at most half full, linear probing.
+  // Duplicate sources keep the first swap.
+  int exactCount = 0;
+  for (quint32 tolerance : m_tolerances)
+    exactCount += tolerance == 0;
+
+  int bits = 1;
+  while ((1 << bits) < exactCount * 2)
+    ++bits;
+  m_exactSlots.fill(Slot(), 1 << bits);
+  m_exactMask = (1u << bits) - 1;
+  m_exactShift = 32 - bits;
+
+  for (int s = 0; s < m_sources.size(); ++s) {
+    if (m_tolerances[s] != 0) {
+      m_toleranceSwaps.append(s);
+      continue;
+    }
+
+    quint32 slot = (m_sources[s] * 0x9e3779b1u) >> m_exactShift;
+    while (m_exactSlots[slot].swap >= 0 &&
+           m_exactSlots[slot].key != m_sources[s])
+      slot = (slot + 1) & m_exactMask;
+    if (m_exactSlots[slot].swap < 0)
+      m_exactSlots[slot] = {m_sources[s], s};
+  }
+
+  // Tolerance swaps: bit j of [channel][value] is set when that channel
+  // value is within tolerance of swap j. A pixel matches the swaps whose bit
+  // is set in all four channels.
+  m_toleranceWords = (m_toleranceSwaps.size() + 63) / 64;
+  m_channelBits.fill(0, 4 * 256 * m_toleranceWords);
+  for (int j = 0; j < m_toleranceSwaps.size(); ++j) {
+    const int s = m_toleranceSwaps[j];
+    for (int channel = 0; channel < 4; ++channel) {
+      const int shift = channel * 8;
+      const int source = int((m_sources[s] >> shift) & 0xff);
+      const int tolerance = int((m_tolerances[s] >> shift) & 0xff);
+      const int lo = qMax(0, source - tolerance);
+      const int hi = qMin(255, source + tolerance);
+      for (int value = lo; value <= hi; ++value)
+        m_channelBits[(channel * 256 + value) * m_toleranceWords + j / 64] |=
+            quint64(1) << (j % 64);
+    }
+  }
+}
+
+// Lowest index of a swap matching color, or -1
+int ColorSwapKernel::findIndexed(quint32 color) const {
+  int best = -1;
+  quint32 slot = (color * 0x9e3779b1u) >> m_exactShift;
+  while (m_exactSlots[slot].swap >= 0) {
+    if (m_exactSlots[slot].key == color) {
+      best = m_exactSlots[slot].swap;
+      break;
+    }
+    slot = (slot + 1) & m_exactMask;
+  }
+
+  const int words = m_toleranceWords;
+  const quint64 *b = m_channelBits.constData() + (color & 0xff) * words;
+  const quint64 *g =
+      m_channelBits.constData() + (256 + ((color >> 8) & 0xff)) * words;
+  const quint64 *r =
+      m_channelBits.constData() + (512 + ((color >> 16) & 0xff)) * words;
+  const quint64 *a = m_channelBits.constData() + (768 + (color >> 24)) * words;
+  for (int w = 0; w < words; ++w) {
+    const quint64 match = b[w] & g[w] & r[w] & a[w];
+    if (match) {
+      const int s = m_toleranceSwaps[w * 64 + qCountTrailingZeroBits(match)];
+      if (best < 0 || s < best)
+        best = s;
+      break;
+    }
+  }
+  return best;
+}
+
+bool ColorSwapKernel::isEmpty() const { return m_sources.isEmpty(); }
+
+bool ColorSwapKernel::isIndexed() const { return m_indexed; }
+
+bool ColorSwapKernel::map(QRgb color, QRgb *dest) const {
+  if (m_generic) {
+    for (int s = 0; s < m_matchers.size(); ++s) {
+      if (m_matchers[s].matches(color)) {
+        *dest = m_dests[s];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (m_indexed) {
+    const int s = findIndexed(color);
+    if (s < 0)
+      return false;
+    *dest = m_dests[s];
+    return true;
+  }
+
+  for (int s = 0; s < m_sources.size(); ++s) {
+    if (channelsWithin(color, m_sources[s], m_tolerances[s])) {
+      *dest = m_dests[s];
+      return true;
+    }
+  }
+  return false;
+}
+
+ColorSwapKernel::Isa ColorSwapKernel::bestIsa() {
+#if defined(CELPAINT_X86)
+  static const Isa isa = []() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx2 = false;
+    // AVX2 also needs the OS to save YMM state
+    if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+      return Isa::Avx2;
+    return sse2 ? Isa::Sse2 : Isa::Scalar;
+  }();
+  return isa;
+#else
+  return Isa::Scalar;
+#endif
+}
+
+bool ColorSwapKernel::apply(QRgb *pixels, qsizetype count) const {
+  return apply(pixels, count, bestIsa());
+}
+
+bool ColorSwapKernel::apply(QRgb *pixels, qsizetype count, Isa isa) const {
+  if (m_sources.isEmpty() || count <= 0)
+    return false;
+
+  // Long runs are matched once and filled. The pixels between them are
+  // batched through the per-pixel path.
+  bool modified = false;
+  qsizetype pending = 0; // Start of the batch of short runs
+  SpanIterator spans(pixels, int(count));
+  PixelSpan span;
+  while (spans.next(&span)) {
+    if (span.length < MinFillRun)
+      continue;
+
+    if (pending < span.x)
+      modified |= applyPixels(pixels + pending, span.x - pending, isa);
+    QRgb dest;
+    if (map(span.color, &dest)) {
+      std::fill(pixels + span.x, pixels + span.x + span.length, dest);
+      modified = true;
+    }
+    pending = span.x + span.length;
+  }
+  if (pending < count)
+    modified |= applyPixels(pixels + pending, count - pending, isa);
+  return modified;
+}
+
+bool ColorSwapKernel::applyPixels(QRgb *pixels, qsizetype count,
+                                  Isa isa) const {
+  if (m_generic)
+    return applyScalar(pixels, count);
+  if (m_indexed)
+    return applyIndexed(pixels, count);
+
+  // Never run a path the CPU lacks, even when forced
+  const Isa best = bestIsa();
+  if (isa == Isa::Avx2 && best == Isa::Avx2)
+    return applyAvx2(pixels, count);
+  if (isa != Isa::Scalar && best != Isa::Scalar)
+    return applySse2(pixels, count);
+  return applyScalar(pixels, count);
+}
+
+bool ColorSwapKernel::applyIndexed(QRgb *pixels, qsizetype count) const {
+  bool modified = false;
+  for (qsizetype i = 0; i < count; ++i) {
+    const int s = findIndexed(pixels[i]);
+    if (s >= 0) {
+      pixels[i] = m_dests[s];
+      modified = true;
+    }
+  }
+  return modified;
+}
+
+bool ColorSwapKernel::applyScalar(QRgb *pixels, qsizetype count) const {
+  bool modified = false;
+  for (qsizetype i = 0; i < count; ++i)
+    modified |= map(pixels[i], &pixels[i]);
+  return modified;
+}
+
+#if defined(CELPAINT_X86)
+
+// Per-byte |a - b| <= tolerance, reduced to a full-lane mask per pixel.
+// Saturating subtraction in both directions gives the absolute difference.
+CELPAINT_TARGET("sse2")
+bool ColorSwapKernel::applySse2(QRgb *pixels, qsizetype count) const {
+  const int swapCount = m_sources.size();
+  const __m128i zero = _mm_setzero_si128();
+  bool modified = false;
+
+  qsizetype i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i *block = reinterpret_cast<__m128i *>(pixels + i);
+    const __m128i px = _mm_loadu_si128(block);
+    __m128i result = px;
+    __m128i pending = _mm_set1_epi32(-1); // Pixels without a match so far
+
+    for (int s = 0; s < swapCount; ++s) {
+      const __m128i src = _mm_set1_epi32(int(m_sources[s]));
+      const __m128i diff =
+          _mm_or_si128(_mm_subs_epu8(px, src), _mm_subs_epu8(src, px));
+      const __m128i over =
+          _mm_subs_epu8(diff, _mm_set1_epi32(int(m_tolerances[s])));
+      const __m128i match =
+          _mm_and_si128(_mm_cmpeq_epi32(over, zero), pending);
+
+      const __m128i dest = _mm_set1_epi32(int(m_dests[s]));
+      result = _mm_or_si128(_mm_and_si128(match, dest),
+                            _mm_andnot_si128(match, result));
+      pending = _mm_andnot_si128(match, pending);
+      if (_mm_movemask_epi8(pending) == 0)
+        break;
+    }
+
+    if (_mm_movemask_epi8(pending) != 0xffff) {
+      _mm_storeu_si128(block, result);
+      modified = true;
+    }
+  }
+
+  return applyScalar(pixels + i, count - i) || modified;
+}
+
+CELPAINT_TARGET("avx2")
+bool ColorSwapKernel::applyAvx2(QRgb *pixels, qsizetype count) const {
+  const int swapCount = m_sources.size();
+  const __m256i zero = _mm256_setzero_si256();
+  bool modified = false;
+
+  qsizetype i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i *block = reinterpret_cast<__m256i *>(pixels + i);
+    const __m256i px = _mm256_loadu_si256(block);
+    __m256i result = px;
+    __m256i pending = _mm256_set1_epi32(-1);
+
+    for (int s = 0; s < swapCount; ++s) {
+      const __m256i src = _mm256_set1_epi32(int(m_sources[s]));
+      const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(px, src),
+                                           _mm256_subs_epu8(src, px));
+      const __m256i over =
+          _mm256_subs_epu8(diff, _mm256_set1_epi32(int(m_tolerances[s])));
+      const __m256i match =
+          _mm256_and_si256(_mm256_cmpeq_epi32(over, zero), pending);
+
+      result = _mm256_blendv_epi8(result, _mm256_set1_epi32(int(m_dests[s])),
+                                  match);
+      pending = _mm256_andnot_si256(match, pending);
+      if (_mm256_testz_si256(pending, pending))
+        break;
+    }
+
+    if (_mm256_movemask_epi8(pending) != -1) {
+      _mm256_storeu_si256(block, result);
+      modified = true;
+    }
+  }
+
+  // The tail still gets four-wide processing
+  return applySse2(pixels + i, count - i) || modified;
+}
+
+#else
+
+bool ColorSwapKernel::applySse2(QRgb *pixels, qsizetype count) const {
+  return applyScalar(pixels, count);
+}
+
+bool ColorSwapKernel::applyAvx2(QRgb *pixels, qsizetype count) const {
+  return applyScalar(pixels, count);
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef COLORSWAPKERNEL_H
+#define COLORSWAPKERNEL_H
+
+#include "CelPaintTypes.h"
+#include "ColorMatcher.h"
+#include <QList>
+#include <QVector>
+#include <QtGui/QRgb>
+
+// Colour swap table compiled once per apply. Enabled swaps are flattened to
+// packed ARGB values, so the per-pixel loop never touches QColor.
+//
+// A swap matches when every channel differs from its source by at most the
+// tolerance (exact swaps have tolerance 0). The first matching swap wins, as
+// in the swap list. Runs of identical pixels are matched once and filled;
+// other pixels are processed 4 (SSE2) or 8 (AVX2) at a time, with the
+// instruction set picked at runtime and a scalar fallback.
+//
+// Large tables (character colour charts run to hundreds of entries) switch to
+// indexed lookup so the per-pixel cost stops growing with the swap count:
+// exact swaps go into an open-addressing hash keyed on the pixel, tolerance
+// swaps into per-channel bitsets of the swaps each channel value satisfies.
+// The lowest matching swap index still wins.
+//
+// Swaps using a metric other than PerChannel (with a non-zero tolerance)
+// cannot be expressed as byte boxes; tables containing them test every swap
+// through ColorMatcher, still once per run.
+class ColorSwapKernel {
+public:
+  enum class Isa { Scalar, Sse2, Avx2 };
+
+  explicit ColorSwapKernel(const QList<ColorSwap> &swaps);
+
+  bool isEmpty() const;
+
+  // Replacement of the first swap matching color, if any
+  bool map(QRgb color, QRgb *dest) const;
+
+  // Replaces matching pixels in place. Returns true if any pixel matched.
+  bool apply(QRgb *pixels, qsizetype count) const;
+  // Same with a forced code path; unsupported ones fall back to scalar.
+  // Indexed tables always take the lookup path.
+  bool apply(QRgb *pixels, qsizetype count, Isa isa) const;
+
+  bool isIndexed() const;
+
+  static Isa bestIsa();
+
+private:
+  QVector<quint32> m_sources;
+  QVector<quint32> m_dests;
+  QVector<quint32> m_tolerances; // Per-channel tolerance in every byte
+
+  // Set when some swap needs a non-box metric
+  bool m_generic = false;
+  QVector<ColorMatcher> m_matchers;
+
+  // Lookup structures, only built for tables above the linear-scan limit
+  struct Slot {
+    quint32 key = 0;
+    int swap = -1; // -1 marks an empty slot
+  };
+  bool m_indexed = false;
+  QVector<Slot> m_exactSlots;
+  quint32 m_exactMask = 0;
+  int m_exactShift = 0;
+  QVector<int> m_toleranceSwaps; // Swap index of each bitset position
+  int m_toleranceWords = 0;
+  QVector<quint64> m_channelBits; // [channel][value][word]
+
+  void buildIndex();
+  int findIndexed(quint32 color) const;
+
+  bool applyPixels(QRgb *pixels, qsizetype count, Isa isa) const;
+  bool applyIndexed(QRgb *pixels, qsizetype count) const;
+  bool applyScalar(QRgb *pixels, qsizetype count) const;
+  bool applySse2(QRgb *pixels, qsizetype count) const;
+  bool applyAvx2(QRgb *pixels, qsizetype count) const;
+};
+
+#endif // COLORSWAPKERNEL_H
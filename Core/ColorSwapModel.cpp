@@ -150,4 +150,19 @@ void ColorSwapModel::setAllTolerance(int tolerance) {
 
 int ColorSwapModel::count() const { return m_swaps.size(); }
 
-QList<ColorSwap> ColorSwapModel::getSwaps() const { return m_swaps; }
+QList<ColorSwap> ColorSwapModel::getSwaps() const {
+  QList<ColorSwap> swaps = m_swaps;
+  for (ColorSwap &swap : swaps)
+    swap.metric = m_metric;
+  return swaps;
+}
+
+int ColorSwapModel::metric() const { return int(m_metric); }
+
+void ColorSwapModel::setMetric(int metric) {
+  if (metric < int(ColorMetric::PerChannel) ||
+      metric > int(ColorMetric::Premultiplied) || metric == int(m_metric))
+    return;
+  m_metric = ColorMetric(metric);
+  emit metricChanged();
+}
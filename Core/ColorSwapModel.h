@@ -10,6 +10,8 @@
 class ColorSwapModel : public QAbstractListModel {
   Q_OBJECT
   Q_PROPERTY(int count READ count NOTIFY countChanged)
+  // ColorMetric used by every swap's tolerance
+  Q_PROPERTY(int metric READ metric WRITE setMetric NOTIFY metricChanged)
 
 public:
   enum Roles {
@@ -43,12 +45,16 @@ public:
   // Accessors
   int count() const;
   QList<ColorSwap> getSwaps() const;
+  int metric() const;
+  void setMetric(int metric);
 
 signals:
   void countChanged();
+  void metricChanged();
 
 private:
   QList<ColorSwap> m_swaps;
+  ColorMetric m_metric = ColorMetric::PerChannel;
 };
 
 #endif // COLORSWAPMODEL_H
@@ -0,0 +1,258 @@
+#include "FloodFill.h"
+#include "ColorMatcher.h"
+#include <algorithm>
+
+namespace {
+
+// Tolerance test against the seed colour. Flat artwork repeats colours in
+// long runs, so the last answer is reused.
+class SeedTest {
+public:
+  SeedTest(QRgb seed, const FillParams &params)
+      : m_matcher(seed, params.tolerance, params.metric), m_last(seed) {}
+
+  bool operator()(QRgb color) {
+    if (color != m_last) {
+      m_last = color;
+      m_match = m_matcher.matches(color);
+    }
+    return m_match;
+  }
+
+private:
+  ColorMatcher m_matcher;
+  QRgb m_last;
+  bool m_match = true;
+};
+
+} // namespace
+
+// Fills m_mask with the spans reachable from seed through pixels open()
+// accepts, hands each new span to onSpan and returns their bounding box.
+//
+// Each stack entry is a row to explore below or above a filled parent span.
+// The parent row is only rescanned where a new span overhangs its parent,
+// so interior pixels are tested about once (Heckbert's seed fill).
+template <typename Open, typename OnSpan>
+QRect FloodFill::walkSpans(int width, int height, const QPoint &seed,
+                           Open open, OnSpan onSpan) {
+  uchar *mask = m_mask.data();
+  int left = width, right = -1, top = height, bottom = -1;
+
+  m_stack.clear();
+  auto push = [&](int y, int x0, int x1, int dy) {
+    if (y + dy >= 0 && y + dy < height)
+      m_stack.append({y + dy, x0, x1, dy});
+  };
+  push(seed.y(), seed.x(), seed.x(), 1);
+  push(seed.y() + 1, seed.x(), seed.x(), -1);
+
+  while (!m_stack.isEmpty()) {
+    const Segment s = m_stack.takeLast();
+    const int y = s.y;
+    uchar *row = mask + qsizetype(y) * width;
+    auto inside = [&](int x) { return !row[x] && open(x, y); };
+
+    // Extend left from the parent's start
+    int x = s.x0;
+    while (x >= 0 && inside(x))
+      row[x--] = 1;
+
+    int start;
+    bool filling;
+    if (x < s.x0) {
+      start = x + 1;
+      if (start < s.x0)
+        push(y, start, s.x0 - 1, -s.dy); // Overhang on the left
+      x = s.x0 + 1;
+      filling = true;
+    } else {
+      // Nothing at the parent's start; find the first open pixel under it
+      for (++x; x <= s.x1 && !inside(x); ++x) {
+      }
+      start = x;
+      filling = x <= s.x1;
+    }
+
+    while (filling) {
+      while (x < width && inside(x))
+        row[x++] = 1;
+      onSpan(y, start, x - 1);
+      push(y, start, x - 1, s.dy);
+      if (x - 1 > s.x1)
+        push(y, s.x1 + 1, x - 1, -s.dy); // Overhang on the right
+
+      left = qMin(left, start);
+      right = qMax(right, x - 1);
+      top = qMin(top, y);
+      bottom = qMax(bottom, y);
+
+      for (++x; x <= s.x1 && !inside(x); ++x) {
+      }
+      start = x;
+      filling = x <= s.x1;
+    }
+  }
+
+  if (right < 0)
+    return QRect();
+  return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+QRect FloodFill::fill(QImage &img, const FillParams &params) {
+  if (img.isNull() || !img.rect().contains(params.seed))
+    return QRect();
+  if (img.format() != QImage::Format_ARGB32)
+    img = img.convertToFormat(QImage::Format_ARGB32);
+
+  const QRgb color = params.fillColor.rgba();
+  const QRgb seedColor = img.pixel(params.seed);
+  if (params.tolerance <= 0 && seedColor == color)
+    return QRect();
+
+  // Detach once rather than on every scanLine()
+  const int w = img.width();
+  QRgb *pixels = reinterpret_cast<QRgb *>(img.bits());
+  const qsizetype stride = img.bytesPerLine() / sizeof(QRgb);
+  bool changed = false;
+  auto paint = [&](int y, int x0, int x1) {
+    QRgb *row = pixels + y * stride;
+    for (int x = x0; x <= x1; ++x) {
+      changed |= row[x] != color;
+      row[x] = color;
+    }
+  };
+
+  QRect bounds;
+  if (params.gapClose > 0) {
+    bounds = region(img, params);
+    for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
+      const uchar *mask = m_mask.constData() + qsizetype(y) * w;
+      for (int x = bounds.left(); x <= bounds.right(); ++x) {
+        if (mask[x])
+          paint(y, x, x);
+      }
+    }
+  } else {
+    // Painted as the walk goes: a span's pixels are never read again since
+    // the mask already excludes them
+    m_mask.fill(0, qsizetype(w) * img.height());
+    SeedTest matches(seedColor, params);
+    bounds = walkSpans(
+        w, img.height(), params.seed,
+        [&](int x, int y) { return matches(pixels[y * stride + x]); }, paint);
+  }
+  return changed ? bounds : QRect();
+}
+
+QRect FloodFill::region(const QImage &img, const FillParams &params) {
+  m_mask.clear();
+  if (img.isNull() || !img.rect().contains(params.seed))
+    return QRect();
+
+  const QImage argb = img.format() == QImage::Format_ARGB32
+                          ? img
+                          : img.convertToFormat(QImage::Format_ARGB32);
+  const int w = argb.width();
+  const int h = argb.height();
+  const QRgb *pixels = reinterpret_cast<const QRgb *>(argb.constBits());
+  const qsizetype stride = argb.bytesPerLine() / sizeof(QRgb);
+  SeedTest matches(argb.pixel(params.seed), params);
+  auto keep = [](int, int, int) {};
+  m_mask.fill(0, qsizetype(w) * h);
+
+  const int gap = params.gapClose;
+  if (gap > 0) {
+    // Boundary grown by the gap radius; the fill may only start outside it
+    m_boundary.resize(qsizetype(w) * h);
+    for (int y = 0; y < h; ++y) {
+      const QRgb *row = pixels + y * stride;
+      uchar *boundary = m_boundary.data() + qsizetype(y) * w;
+      for (int x = 0; x < w; ++x)
+        boundary[x] = !matches(row[x]);
+    }
+    QVector<uchar> blocked = m_boundary;
+    dilate(blocked, w, h, gap);
+
+    const qsizetype seedIndex = qsizetype(params.seed.y()) * w + params.seed.x();
+    if (!blocked[seedIndex]) {
+      const uchar *closed = blocked.constData();
+      QRect bounds = walkSpans(
+          w, h, params.seed,
+          [&](int x, int y) { return !closed[qsizetype(y) * w + x]; }, keep);
+
+      // Grow back over matching pixels so the fill meets the boundary
+      dilate(m_mask, w, h, gap);
+      const QRect grown = bounds.adjusted(-gap, -gap, gap, gap) & argb.rect();
+      int left = w, right = -1, top = -1, bottom = -1;
+      for (int y = grown.top(); y <= grown.bottom(); ++y) {
+        uchar *mask = m_mask.data() + qsizetype(y) * w;
+        const uchar *boundary = m_boundary.constData() + qsizetype(y) * w;
+        for (int x = grown.left(); x <= grown.right(); ++x) {
+          mask[x] &= !boundary[x];
+          if (mask[x]) {
+            left = qMin(left, x);
+            right = qMax(right, x);
+            if (top < 0)
+              top = y;
+            bottom = y;
+          }
+        }
+      }
+      return QRect(QPoint(left, top), QPoint(right, bottom));
+    }
+    // The seed sits in a gap-sized opening itself; fill without closing
+  }
+
+  return walkSpans(
+      w, h, params.seed,
+      [&](int x, int y) { return matches(pixels[y * stride + x]); }, keep);
+}
+
+const QVector<uchar> &FloodFill::mask() const { return m_mask; }
+
+// Square dilation, separable into a sliding window count along rows and then
+// along columns
+void FloodFill::dilate(QVector<uchar> &mask, int width, int height,
+                       int radius) {
+  if (radius <= 0 || mask.isEmpty())
+    return;
+
+  QVector<uchar> rows(mask.size());
+  for (int y = 0; y < height; ++y) {
+    const uchar *in = mask.constData() + qsizetype(y) * width;
+    uchar *out = rows.data() + qsizetype(y) * width;
+    int count = 0;
+    for (int x = 0; x < qMin(radius, width - 1) + 1; ++x)
+      count += in[x];
+    for (int x = 0; x < width; ++x) {
+      out[x] = count > 0;
+      if (x + radius + 1 < width)
+        count += in[x + radius + 1];
+      if (x - radius >= 0)
+        count -= in[x - radius];
+    }
+  }
+
+  QVector<int> counts(width, 0);
+  for (int y = 0; y < qMin(radius, height - 1) + 1; ++y) {
+    const uchar *in = rows.constData() + qsizetype(y) * width;
+    for (int x = 0; x < width; ++x)
+      counts[x] += in[x];
+  }
+  for (int y = 0; y < height; ++y) {
+    uchar *out = mask.data() + qsizetype(y) * width;
+    for (int x = 0; x < width; ++x)
+      out[x] = counts[x] > 0;
+    if (y + radius + 1 < height) {
+      const uchar *in = rows.constData() + qsizetype(y + radius + 1) * width;
+      for (int x = 0; x < width; ++x)
+        counts[x] += in[x];
+    }
+    if (y - radius >= 0) {
+      const uchar *in = rows.constData() + qsizetype(y - radius) * width;
+      for (int x = 0; x < width; ++x)
+        counts[x] -= in[x];
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include "CelPaintTypes.h"
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// Bucket fill on ARGB32 scanlines: the 4-connected region of pixels within
+// tolerance of the seed pixel's colour.
+//
+// The region is walked as horizontal spans. Each span is extended left and
+// right along its row and queues the rows next to it over its extent; the
+// row it came from is only revisited where it overhangs its parent. There
+// are no per-pixel stack entries, so a fill costs about one pass over the
+// region.
+//
+// Gap closing treats every pixel within gapClose of the boundary as boundary
+// too, so the fill cannot leak through openings up to twice that wide, then
+// grows the result back by gapClose over region pixels so it still reaches
+// the line art. It needs two dilations of the whole frame.
+//
+// Buffers are kept between calls; reuse one filler per thread.
+class FloodFill {
+public:
+  // Fills img, converted to ARGB32 if needed, and returns the bounding box
+  // of the region; empty if no pixel changed
+  QRect fill(QImage &img, const FillParams &params);
+
+  // Marks the region without changing img and returns its bounding box;
+  // mask() then holds 1 for every region pixel, row-major
+  QRect region(const QImage &img, const FillParams &params);
+  const QVector<uchar> &mask() const;
+
+private:
+  struct Segment {
+    int y; // Row to explore
+    int x0;
+    int x1; // Inclusive extent of the filled span it was reached from
+    int dy; // Direction away from that span
+  };
+
+  QVector<uchar> m_mask;
+  QVector<uchar> m_boundary; // Pixels outside the tolerance, for gap closing
+  QVector<Segment> m_stack;
+
+  template <typename Open, typename OnSpan>
+  QRect walkSpans(int width, int height, const QPoint &seed, Open open,
+                  OnSpan onSpan);
+  static void dilate(QVector<uchar> &mask, int width, int height, int radius);
+};
+
+#endif // FLOODFILL_H
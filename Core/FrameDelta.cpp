@@ -0,0 +1,152 @@
+#include "FrameDelta.h"
+#include <QHash>
+#include <cstring>
+
+// Edits are local, so small tiles keep the unchanged area out of the delta
+static const int TileSize = 64;
+// The XOR of an edit is mostly zero runs; the fastest level already packs
+// those tightly
+static const int CompressionLevel = 1;
+
+FrameDelta::FrameDelta(const QImage &before, const QImage &after) {
+  if (before.isNull() && after.isNull())
+    return;
+  m_beforeHash = fingerprint(before);
+  m_afterHash = fingerprint(after);
+  if (before.size() != after.size() || before.format() != after.format() ||
+      before.depth() < 8) {
+    m_whole = true;
+    m_before = pack(before);
+    m_after = pack(after);
+    return;
+  }
+
+  m_size = before.size();
+  m_format = before.format();
+  if (before.colorTable() != after.colorTable()) {
+    m_beforeColors = before.colorTable();
+    m_afterColors = after.colorTable();
+  }
+
+  const int w = m_size.width();
+  const int h = m_size.height();
+  const int bpp = before.depth() / 8;
+  QByteArray raw;
+  for (int ty = 0; ty * TileSize < h; ++ty) {
+    const int top = ty * TileSize;
+    const int bottom = qMin(top + TileSize, h);
+    for (int tx = 0; tx * TileSize < w; ++tx) {
+      const qsizetype offset = qsizetype(tx) * TileSize * bpp;
+      const qsizetype bytes = qsizetype(qMin(TileSize, w - tx * TileSize)) * bpp;
+      bool changed = false;
+      for (int y = top; y < bottom && !changed; ++y)
+        changed = std::memcmp(before.constScanLine(y) + offset,
+                              after.constScanLine(y) + offset, bytes) != 0;
+      if (!changed)
+        continue;
+
+      m_tiles.append(QPoint(tx, ty));
+      const qsizetype start = raw.size();
+      raw.resize(start + bytes * (bottom - top));
+      char *out = raw.data() + start;
+      for (int y = top; y < bottom; ++y, out += bytes) {
+        const uchar *a = before.constScanLine(y) + offset;
+        const uchar *b = after.constScanLine(y) + offset;
+        for (qsizetype i = 0; i < bytes; ++i)
+          out[i] = char(a[i] ^ b[i]);
+      }
+    }
+  }
+  if (!raw.isEmpty())
+    m_xor = qCompress(raw, CompressionLevel);
+}
+
+bool FrameDelta::isEmpty() const {
+  return !m_whole && m_tiles.isEmpty() && m_beforeColors == m_afterColors;
+}
+
+QImage FrameDelta::apply(const QImage &image) const {
+  if (isEmpty())
+    return image;
+  const size_t hash = fingerprint(image);
+  const bool isAfter = hash == m_afterHash;
+  if (!isAfter && hash != m_beforeHash)
+    return QImage();
+  if (m_whole)
+    return unpack(isAfter ? m_before : m_after);
+
+  QImage result = image;
+  if (!m_tiles.isEmpty()) {
+    const QByteArray raw = qUncompress(m_xor);
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const int bpp = result.depth() / 8;
+    const char *in = raw.constData();
+    for (const QPoint &tile : m_tiles) {
+      const int top = tile.y() * TileSize;
+      const int bottom = qMin(top + TileSize, h);
+      const qsizetype offset = qsizetype(tile.x()) * TileSize * bpp;
+      const qsizetype bytes =
+          qsizetype(qMin(TileSize, w - tile.x() * TileSize)) * bpp;
+      for (int y = top; y < bottom; ++y, in += bytes) {
+        uchar *row = result.scanLine(y) + offset;
+        for (qsizetype i = 0; i < bytes; ++i)
+          row[i] ^= uchar(in[i]);
+      }
+    }
+  }
+  if (m_beforeColors != m_afterColors)
+    result.setColorTable(isAfter ? m_beforeColors : m_afterColors);
+  return result;
+}
+
+// Pixel rows without padding, palette, size and format
+size_t FrameDelta::fingerprint(const QImage &image) {
+  if (image.isNull())
+    return 0;
+  size_t hash =
+      qHashMulti(0, image.width(), image.height(), int(image.format()));
+  const QVector<QRgb> colors = image.colorTable();
+  hash = qHashBits(colors.constData(), colors.size() * sizeof(QRgb), hash);
+  const qsizetype rowBytes = (qsizetype(image.width()) * image.depth() + 7) / 8;
+  for (int y = 0; y < image.height(); ++y)
+    hash = qHashBits(image.constScanLine(y), rowBytes, hash);
+  return hash;
+}
+
+qint64 FrameDelta::byteCost() const {
+  return qint64(sizeof(FrameDelta)) + m_xor.size() +
+         m_tiles.size() * qint64(sizeof(QPoint)) +
+         (m_beforeColors.size() + m_afterColors.size()) * qint64(sizeof(QRgb)) +
+         m_before.bits.size() + m_before.colors.size() * qint64(sizeof(QRgb)) +
+         m_after.bits.size() + m_after.colors.size() * qint64(sizeof(QRgb));
+}
+
+FrameDelta::Packed FrameDelta::pack(const QImage &image) {
+  Packed packed;
+  if (image.isNull())
+    return packed;
+
+  packed.size = image.size();
+  packed.format = image.format();
+  packed.colors = image.colorTable();
+  const qsizetype rowBytes = (qsizetype(image.width()) * image.depth() + 7) / 8;
+  QByteArray raw(rowBytes * image.height(), Qt::Uninitialized);
+  for (int y = 0; y < image.height(); ++y)
+    std::memcpy(raw.data() + y * rowBytes, image.constScanLine(y), rowBytes);
+  packed.bits = qCompress(raw, CompressionLevel);
+  return packed;
+}
+
+QImage FrameDelta::unpack(const Packed &packed) {
+  if (packed.format == QImage::Format_Invalid)
+    return QImage();
+
+  QImage image(packed.size, packed.format);
+  image.setColorTable(packed.colors);
+  const QByteArray raw = qUncompress(packed.bits);
+  const qsizetype rowBytes = (qsizetype(image.width()) * image.depth() + 7) / 8;
+  for (int y = 0; y < image.height(); ++y)
+    std::memcpy(image.scanLine(y), raw.constData() + y * rowBytes, rowBytes);
+  return image;
+}
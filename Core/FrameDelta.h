@@ -0,0 +1,55 @@
+#ifndef FRAMEDELTA_H
+#define FRAMEDELTA_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+
+// Difference between two versions of a frame for undo history. Only the
+// tiles that changed are kept, as the compressed XOR of their bytes; XOR is
+// its own inverse, so applying the delta to either version gives the other,
+// bit for bit. Versions of different size or format are kept whole instead,
+// compressed.
+//
+// Both versions are fingerprinted, so a delta is never applied to pixels it
+// was not recorded against (e.g. a frame reloaded from disk since).
+class FrameDelta {
+public:
+  FrameDelta() = default;
+  FrameDelta(const QImage &before, const QImage &after);
+
+  bool isEmpty() const;
+  // Given one version, returns the other; null for any other image
+  QImage apply(const QImage &image) const;
+  // Bytes held, for the undo budget
+  qint64 byteCost() const;
+
+private:
+  // A whole version, for deltas between different formats
+  struct Packed {
+    QSize size;
+    QImage::Format format = QImage::Format_Invalid;
+    QVector<QRgb> colors;
+    QByteArray bits; // Compressed rows without padding
+  };
+
+  bool m_whole = false;
+  size_t m_beforeHash = 0;
+  size_t m_afterHash = 0;
+  QSize m_size;
+  QImage::Format m_format = QImage::Format_Invalid;
+  // Palettes change independently of the indices, so both are kept
+  QVector<QRgb> m_beforeColors;
+  QVector<QRgb> m_afterColors;
+  QVector<QPoint> m_tiles; // Tile column and row of each changed tile
+  QByteArray m_xor;        // Compressed XOR of the changed tiles in order
+
+  Packed m_before;
+  Packed m_after;
+
+  static size_t fingerprint(const QImage &image);
+  static Packed pack(const QImage &image);
+  static QImage unpack(const Packed &packed);
+};
+
+#endif // FRAMEDELTA_H
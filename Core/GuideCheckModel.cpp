@@ -112,8 +112,19 @@ QList<GuideColorParams> GuideCheckModel::getChecks(int radius,
     if (p.enabled) {
       p.radius = radius;
       p.thickness = thickness;
+      p.metric = m_metric;
       result.append(p);
     }
   }
   return result;
 }
+
+int GuideCheckModel::metric() const { return int(m_metric); }
+
+void GuideCheckModel::setMetric(int metric) {
+  if (metric < int(ColorMetric::PerChannel) ||
+      metric > int(ColorMetric::Premultiplied) || metric == int(m_metric))
+    return;
+  m_metric = ColorMetric(metric);
+  emit metricChanged();
+}
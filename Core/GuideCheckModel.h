@@ -9,6 +9,8 @@
 
 class GuideCheckModel : public QAbstractListModel {
   Q_OBJECT
+  // ColorMetric used by every check's tolerance
+  Q_PROPERTY(int metric READ metric WRITE setMetric NOTIFY metricChanged)
 public:
   enum GuideCheckRoles {
     SourceColorRole = Qt::UserRole + 1,
@@ -37,8 +39,15 @@ public:
   // settings
   QList<GuideColorParams> getChecks(int radius, int thickness) const;
 
+  int metric() const;
+  void setMetric(int metric);
+
+signals:
+  void metricChanged();
+
 private:
   QList<GuideColorParams> m_checks;
+  ColorMetric m_metric = ColorMetric::PerChannel;
 };
 
 #endif // GUIDECHECKMODEL_H
@@ -1,167 +1,744 @@
 #include "ImageSequence.h"
-#include <QDataStream>
+#include "ColorMatcher.h"
+#include "FloodFill.h"
+#include "PixelSpans.h"
+#include "RegionLabeler.h"
+#include "RegionMatcher.h"
+#include "SequenceCache.h"
+#include "TgaCodec.h"
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPen>
 #include <QPoint>
+#include <QSaveFile>
 #include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtGlobal>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <numeric>
 #include <queue>
 #include <vector>
 
 ImageSequence::ImageSequence(QObject *parent)
-    : QObject(parent), m_currentIndex(-1) {}
-
-// Minimal TGA Loader (Uncompressed & RLE TrueColor)
-static QImage loadTGA(const QString &filePath) {
-  QFile file(filePath);
-  if (!file.open(QIODevice::ReadOnly))
-    return QImage();
-
-  QDataStream in(&file);
-  in.setByteOrder(QDataStream::LittleEndian);
-
-  quint8 idLength, colorMapType, imageType;
-  quint8 temp8;
-  quint16 temp16;
-  quint16 width, height;
-  quint8 pixelDepth, descriptor;
+    : QObject(parent), m_currentIndex(-1),
+      m_fileWatcher(new QFileSystemWatcher(this)),
+      m_reloadTimer(new QTimer(this)) {
+  // Exporters often write a file in several steps; settle before reloading
+  m_reloadTimer->setSingleShot(true);
+  m_reloadTimer->setInterval(300);
+  connect(m_reloadTimer, &QTimer::timeout, this,
+          &ImageSequence::reloadChangedFrames);
+  connect(m_fileWatcher, &QFileSystemWatcher::fileChanged, this,
+          &ImageSequence::onSourceFileChanged);
+}
 
-  in >> idLength >> colorMapType >> imageType;
-  in.skipRawData(5); // Skip color map spec
-  in.skipRawData(4); // Skip x, y origin
-  in >> width >> height >> pixelDepth >> descriptor;
+ImageSequence::~ImageSequence() {
+  abortReload();
+  abortLoading();
+  waitForSave();
+  m_sequenceCacheWrite.waitForFinished();
+}
 
-  // Only support TrueColor (2) and RLE TrueColor (10)
-  // Supports 24 and 32 bit depth
-  if ((imageType != 2 && imageType != 10) ||
-      (pixelDepth != 24 && pixelDepth != 32)) {
+// Decodes a single frame. Runs on worker threads, so it must not touch any
+// ImageSequence state. The file is read in one block; contentHash receives a
+// hash of its bytes so live reload can tell real changes from touches.
+static QImage decodeFrame(const QString &path, size_t *contentHash = nullptr) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
     return QImage();
+  const QByteArray data = file.readAll();
+  if (contentHash)
+    *contentHash = qHash(data);
+
+  QImage img;
+  if (path.endsWith(".tga", Qt::CaseInsensitive)) {
+    // Bulk scanline decoder; Qt's plugin only serves as a fallback
+    img = TgaCodec::read(reinterpret_cast<const uchar *>(data.constData()),
+                         data.size());
+  }
+  if (img.isNull()) {
+    img = QImage::fromData(data);
   }
 
-  in.skipRawData(idLength); // Skip ID field
-  // Skip color map if present (shouldn't be for type 2/10 usually, but logic
-  // implies unsupp if colorMapType=1)
+  // Convert to ARGB32 for consistent pixel manipulation
+  if (!img.isNull() && img.format() != QImage::Format_ARGB32) {
+    img = img.convertToFormat(QImage::Format_ARGB32);
+  }
+  return img;
+}
 
-  QImage image(width, height, QImage::Format_ARGB32);
-  image.fill(Qt::transparent);
+// Converts an ARGB32 frame to Format_Indexed8 when it uses at most 256
+// colours. The conversion is exact; frames with more colours are returned
+// unchanged.
+static QImage toIndexedFrame(const QImage &img) {
+  if (img.format() != QImage::Format_ARGB32)
+    return img;
+
+  const int w = img.width();
+  const int h = img.height();
+  QImage indexed(w, h, QImage::Format_Indexed8);
+  if (indexed.isNull())
+    return img;
+
+  // Open-addressing colour -> index table; 512 slots keep probing short
+  const int slotCount = 512;
+  QRgb slotColor[slotCount];
+  int slotIndex[slotCount];
+  std::fill(slotIndex, slotIndex + slotCount, -1);
+  QVector<QRgb> palette;
 
-  bool isRLE = (imageType == 10);
-  int bytesPerPixel = pixelDepth / 8;
-  quint64 totalPixels = width * height;
-  quint64 currentPixel = 0;
+  for (int y = 0; y < h; ++y) {
+    const QRgb *src = reinterpret_cast<const QRgb *>(img.constScanLine(y));
+    uchar *dst = indexed.scanLine(y);
+    QRgb lastColor = 0;
+    int lastIndex = -1;
 
-  while (currentPixel < totalPixels && !in.atEnd()) {
-    quint8 chunkHeader;
-    if (isRLE) {
-      in >> chunkHeader;
-    } else {
-      chunkHeader = 127; // Treat as raw packet of max length 128 (0-127)
+    for (int x = 0; x < w; ++x) {
+      const QRgb c = src[x];
+      if (c != lastColor || lastIndex < 0) {
+        uint slot = (c * 2654435761u) >> 23; // 9-bit hash
+        while (slotIndex[slot] >= 0 && slotColor[slot] != c)
+          slot = (slot + 1) & (slotCount - 1);
+
+        if (slotIndex[slot] < 0) {
+          if (palette.size() == 256)
+            return img;
+          slotColor[slot] = c;
+          slotIndex[slot] = palette.size();
+          palette.append(c);
+        }
+        lastColor = c;
+        lastIndex = slotIndex[slot];
+      }
+      dst[x] = uchar(lastIndex);
     }
+  }
 
-    bool isRaw = !isRLE || (chunkHeader < 128);
-    int chunkCount = (chunkHeader & 0x7F) + 1;
+  indexed.setColorTable(palette);
+  return indexed;
+}
 
-    if (isRaw) { // Raw packet
-      for (int i = 0; i < chunkCount; ++i) {
-        if (currentPixel >= totalPixels)
-          break;
+// Reads only the image header. Used for lazy frames, which are decoded later.
+static QSize probeFrameSize(const QString &path) {
+  QImageReader reader(path);
+  QSize size = reader.size();
+  if (size.isValid())
+    return size;
 
-        quint8 b, g, r, a = 255;
-        in >> b >> g >> r;
-        if (bytesPerPixel == 4)
-          in >> a;
+  if (path.endsWith(".tga", Qt::CaseInsensitive))
+    size = TgaCodec::readSize(path);
+  return size;
+}
 
-        int x = currentPixel % width;
-        int y = currentPixel / width;
-        if (descriptor & 0x20)
-          y = y;
-        else
-          y = height - 1 - y; // TGA is bottom-up unless bit 5 set
+void ImageSequence::loadSequence(const QStringList &filePaths) {
+  abortReload();
+  abortLoading();
+  waitForSave();
 
-        image.setPixelColor(x, y, QColor(r, g, b, a));
-        currentPixel++;
-      }
-    } else { // RLE packet (Run-length)
-      quint8 b, g, r, a = 255;
-      in >> b >> g >> r;
-      if (bytesPerPixel == 4)
-        in >> a;
-      QColor color(r, g, b, a);
-
-      for (int i = 0; i < chunkCount; ++i) {
-        if (currentPixel >= totalPixels)
-          break;
-
-        int x = currentPixel % width;
-        int y = currentPixel / width;
-        if (descriptor & 0x20)
-          y = y;
-        else
-          y = height - 1 - y;
+  m_pendingReloads.clear();
+  if (!m_fileWatcher->files().isEmpty())
+    m_fileWatcher->removePaths(m_fileWatcher->files());
 
-        image.setPixelColor(x, y, color);
-        currentPixel++;
-      }
-    }
+  m_frames.clear();
+  m_currentIndex = -1;
+  {
+    QMutexLocker locker(&m_frameCacheMutex);
+    m_frameCache.clear();
+    m_lazyFrames = m_frameCacheBudget > 0;
+    if (m_lazyFrames)
+      m_frameCache.setMaxCost(m_frameCacheBudget);
+  }
+  m_indexedFrames = m_indexedStorage;
+
+  // A sidecar from the previous load may still be being written
+  m_sequenceCacheWrite.waitForFinished();
+  m_sequenceCache.reset();
+  m_sequenceCacheMisses = 0;
+  if (m_sequenceCacheEnabled && !filePaths.isEmpty()) {
+    auto cache = QSharedPointer<SequenceCache>::create();
+    if (cache->open(SequenceCache::cachePathFor(filePaths.first())))
+      m_sequenceCache = cache;
   }
+  emit framesCleared();
+  emit countChanged();
 
-  return image;
+  if (filePaths.isEmpty())
+    return;
+
+  m_loadPaths = filePaths;
+  m_nextLoadIndex = 0;
+
+  m_loadWatcher = new QFutureWatcher<LoadedFrame>(this);
+  connect(m_loadWatcher, &QFutureWatcher<LoadedFrame>::resultReadyAt, this,
+          &ImageSequence::commitDecodedFrames);
+  connect(m_loadWatcher, &QFutureWatcher<LoadedFrame>::progressValueChanged,
+          this,
+          [this](int value) { emit loadProgress(value, m_loadPaths.size()); });
+  connect(m_loadWatcher, &QFutureWatcher<LoadedFrame>::finished, this,
+          &ImageSequence::onLoadFinished);
+
+  const bool lazy = m_lazyFrames;
+  const bool indexed = m_indexedFrames;
+  QSharedPointer<SequenceCache> cache = m_sequenceCache;
+  emit loadingChanged();
+  emit loadProgress(0, m_loadPaths.size());
+  m_loadWatcher->setFuture(QtConcurrent::mapped(
+      m_loadPaths, [lazy, indexed, cache](const QString &path) {
+        LoadedFrame frame;
+        if (lazy) {
+          frame.size = probeFrameSize(path);
+          return frame;
+        }
+
+        if (cache) {
+          frame.image = cache->read(path);
+          frame.fromCache = !frame.image.isNull();
+        }
+        if (!frame.fromCache)
+          frame.image = decodeFrame(path, &frame.sourceHash);
+        if (indexed)
+          frame.image = toIndexedFrame(frame.image);
+        frame.size = frame.image.size();
+        frame.colors = ColorPresence::fromImage(frame.image);
+        return frame;
+      }));
 }
 
-void ImageSequence::loadSequence(const QStringList &filePaths) {
-  m_frames.clear();
-  m_currentIndex = -1;
+void ImageSequence::cancelLoading() {
+  // The finished() handler keeps whatever was committed so far.
+  if (m_loadWatcher)
+    m_loadWatcher->cancel();
+}
 
-  for (const QString &path : filePaths) {
-    QImage img(path);
-    if (img.isNull()) {
-      // Try manual TGA loader
-      if (path.endsWith(".tga", Qt::CaseInsensitive)) {
-        img = loadTGA(path);
-      }
-    }
+bool ImageSequence::isLoading() const { return m_loadWatcher != nullptr; }
+
+// Appends the contiguous run of decoded frames that follows the last committed
+// one, so frames always end up in file order even though workers finish out of
+// order. Unreadable files are skipped.
+void ImageSequence::commitDecodedFrames() {
+  if (!m_loadWatcher)
+    return;
+
+  QFuture<LoadedFrame> future = m_loadWatcher->future();
+  int end = m_nextLoadIndex;
+  int added = 0;
+  while (end < m_loadPaths.size() && future.isResultReadyAt(end)) {
+    const QSize size = future.resultAt(end).size;
+    if (size.isValid() && !size.isEmpty())
+      ++added;
+    ++end;
+  }
 
-    if (!img.isNull()) {
-      // Convert to ARGB32 for consistent pixel manipulation
-      if (img.format() != QImage::Format_ARGB32) {
-        img = img.convertToFormat(QImage::Format_ARGB32);
-      }
-      m_frames.append({path, img});
+  const int first = int(m_frames.size());
+  if (added > 0)
+    emit framesAboutToBeAppended(first, first + added - 1);
+  for (; m_nextLoadIndex < end; ++m_nextLoadIndex) {
+    LoadedFrame loaded = future.resultAt(m_nextLoadIndex);
+    if (!loaded.fromCache)
+      ++m_sequenceCacheMisses;
+    if (loaded.size.isValid() && !loaded.size.isEmpty()) {
+      Frame frame;
+      frame.originalPath = m_loadPaths[m_nextLoadIndex];
+      frame.image = loaded.image;
+      frame.size = loaded.size;
+      frame.sourceHash = loaded.sourceHash;
+      frame.colors = loaded.colors;
+      m_frames.append(frame);
     }
   }
 
+  if (added == 0)
+    return;
+
+  emit framesAppended();
   emit countChanged();
 
-  if (!m_frames.isEmpty()) {
+  // Show the first frame as soon as it is available
+  if (m_currentIndex < 0) {
     m_currentIndex = 0;
-    emit sequenceLoaded();
     emit currentIndexChanged(m_currentIndex);
-    emit currentImageChanged(m_frames[0].image);
+    emit currentImageChanged(frameImage(0));
+  }
+}
+
+void ImageSequence::onLoadFinished() {
+  bool canceled = m_loadWatcher->isCanceled();
+  if (!canceled)
+    commitDecodedFrames();
+
+  // Drop the future so its result store does not keep the decoded images alive
+  m_loadWatcher->deleteLater();
+  m_loadWatcher = nullptr;
+  m_loadPaths.clear();
+  m_nextLoadIndex = 0;
+  emit loadingChanged();
+
+  if (!m_lazyFrames) {
+    // Release the mapping first; the sidecar cannot be replaced while mapped
+    // on every platform
+    m_sequenceCache.reset();
+    if (!canceled && m_sequenceCacheEnabled && m_sequenceCacheMisses > 0)
+      writeSequenceCache();
+  }
+
+  watchSourceFiles();
+
+  if (!m_frames.isEmpty())
+    emit sequenceLoaded();
+  if (canceled)
+    emit loadCanceled();
+}
+
+// Packs the unedited frames into the sidecar on a worker thread
+void ImageSequence::writeSequenceCache() {
+  if (m_frames.isEmpty())
+    return;
+
+  QList<QPair<QString, QImage>> frames;
+  for (const Frame &frame : m_frames) {
+    if (!frame.dirty)
+      frames.append({frame.originalPath, frame.image});
   }
+
+  const QString cachePath =
+      SequenceCache::cachePathFor(m_frames.first().originalPath);
+  m_sequenceCacheWrite = QtConcurrent::run(
+      [cachePath, frames]() { SequenceCache::write(cachePath, frames); });
+}
+
+// Stops an in-flight load without committing anything further. Used when a new
+// sequence replaces the current one and on destruction.
+void ImageSequence::abortLoading() {
+  if (!m_loadWatcher)
+    return;
+
+  m_loadWatcher->disconnect(this);
+  m_loadWatcher->cancel();
+  m_loadWatcher->waitForFinished();
+  m_loadWatcher->deleteLater();
+  m_loadWatcher = nullptr;
+  m_loadPaths.clear();
+  m_nextLoadIndex = 0;
+  emit loadingChanged();
+}
+
+// Writes one frame atomically: QSaveFile only replaces the target once all
+// data is flushed. Qt has no TGA writer, so TGA goes through the native RLE
+// encoder.
+static bool writeFrame(const QImage &image, const QString &path,
+                       const QString &format) {
+  if (image.isNull())
+    return false;
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+
+  bool written;
+  if (format.compare("tga", Qt::CaseInsensitive) == 0 ||
+      format.compare("targa", Qt::CaseInsensitive) == 0) {
+    written = TgaCodec::write(image, &file, true);
+  } else {
+    written = image.save(&file, format.toLatin1().constData());
+  }
+
+  if (!written) {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+QStringList ImageSequence::imageNameFilters() {
+  return {"*.png", "*.jpg",  "*.jpeg", "*.bmp",
+          "*.tga", "*.targa", "*.tif", "*.tiff"};
+}
+
+QImage ImageSequence::readFrameFile(const QString &path) {
+  return decodeFrame(path);
+}
+
+bool ImageSequence::writeFrameFile(const QImage &image, const QString &path,
+                                   const QString &format) {
+  return writeFrame(image, path, format);
 }
 
 void ImageSequence::saveSequence(const QString &outputDir,
-                                 const QString &format) {
+                                 const QString &format, bool modifiedOnly) {
+  finishSave();
+
   QDir dir(outputDir);
   if (!dir.exists()) {
     dir.mkpath(".");
   }
 
+  QList<SaveJob> jobs;
   for (int i = 0; i < m_frames.size(); ++i) {
-    QString fileName = QFileInfo(m_frames[i].originalPath).fileName();
-    QString newPath = dir.filePath(fileName);
-    m_frames[i].image.save(newPath, format.toLatin1().constData());
+    const Frame &frame = m_frames[i];
+    if (modifiedOnly && !frame.dirty)
+      continue;
+
+    QFileInfo source(frame.originalPath);
+    SaveJob job;
+    job.index = i;
+    job.image = frame.image;
+    job.imageKey = frame.image.cacheKey();
+    job.sourcePath = frame.originalPath;
+    job.format = format.isEmpty() ? source.suffix() : format;
+    job.targetPath = dir.filePath(
+        format.isEmpty() ? source.fileName()
+                         : source.completeBaseName() + "." + format.toLower());
+    jobs.append(job);
+  }
+
+  m_saveWatcher = new QFutureWatcher<SaveJob>(this);
+  connect(m_saveWatcher, &QFutureWatcher<SaveJob>::progressValueChanged, this,
+          [this](int value) {
+            emit saveProgress(value, m_saveWatcher->progressMaximum());
+          });
+  connect(m_saveWatcher, &QFutureWatcher<SaveJob>::finished, this,
+          &ImageSequence::onSaveFinished);
+
+  emit saveProgress(0, jobs.size());
+  m_saveWatcher->setFuture(QtConcurrent::mapped(jobs, [](SaveJob job) {
+    QImage image =
+        job.image.isNull() ? decodeFrame(job.sourcePath) : job.image;
+    job.ok = writeFrame(image, job.targetPath, job.format);
+    job.image = QImage();
+
+    // Remember what was written over the source so live reload ignores it
+    if (job.ok && QFileInfo(job.targetPath) == QFileInfo(job.sourcePath)) {
+      QFile written(job.targetPath);
+      if (written.open(QIODevice::ReadOnly)) {
+        job.overwroteSource = true;
+        job.writtenHash = qHash(written.readAll());
+      }
+    }
+    return job;
+  }));
+}
+
+bool ImageSequence::isSaving() const { return m_saveWatcher != nullptr; }
+
+int ImageSequence::modifiedCount() const {
+  int count = 0;
+  for (const Frame &frame : m_frames) {
+    if (frame.dirty)
+      ++count;
+  }
+  return count;
+}
+
+void ImageSequence::onSaveFinished() {
+  const QList<SaveJob> jobs = m_saveWatcher->future().results();
+  m_saveWatcher->deleteLater();
+  m_saveWatcher = nullptr;
+
+  int written = 0;
+  QStringList failedPaths;
+  for (const SaveJob &job : jobs) {
+    if (!job.ok) {
+      failedPaths.append(job.targetPath);
+      continue;
+    }
+    ++written;
+
+    if (job.index >= m_frames.size())
+      continue;
+
+    // Frames edited while the export ran stay dirty
+    Frame &frame = m_frames[job.index];
+    if (frame.image.cacheKey() == job.imageKey)
+      frame.dirty = false;
+    if (job.overwroteSource) {
+      frame.sourceHash = job.writtenHash;
+      frame.reloadConflict = false;
+    }
+  }
+
+  emit saveFinished(written, failedPaths);
+}
+
+// Completes a running export and reports it, so every saveSequence() gets its
+// saveFinished(). The frame list is unchanged, so its results still apply.
+void ImageSequence::finishSave() {
+  if (!m_saveWatcher)
+    return;
+
+  // The watcher's own finished() is still queued; it must not report twice
+  m_saveWatcher->disconnect(this);
+  m_saveWatcher->waitForFinished();
+  onSaveFinished();
+}
+
+// Lets a running export complete before the frame list changes underneath it.
+// Its results are dropped since the frame indices no longer apply.
+void ImageSequence::waitForSave() {
+  if (!m_saveWatcher)
+    return;
+
+  m_saveWatcher->disconnect(this);
+  m_saveWatcher->waitForFinished();
+  m_saveWatcher->deleteLater();
+  m_saveWatcher = nullptr;
+}
+
+void ImageSequence::watchSourceFiles() {
+  QStringList paths;
+  for (const Frame &frame : m_frames)
+    paths.append(frame.originalPath);
+  if (!paths.isEmpty())
+    m_fileWatcher->addPaths(paths);
+}
+
+void ImageSequence::onSourceFileChanged(const QString &path) {
+  m_pendingReloads.insert(path);
+  m_reloadTimer->start();
+}
+
+// Re-decodes the pending sources on the thread pool. Only frames whose file
+// content hash actually changed are replaced; see onReloadFinished().
+void ImageSequence::reloadChangedFrames() {
+  // Our own exports also trigger change notifications; wait for them
+  if (m_reloadWatcher || m_loadWatcher || m_saveWatcher) {
+    m_reloadTimer->start();
+    return;
+  }
+
+  QList<ReloadJob> jobs;
+  for (int i = 0; i < m_frames.size(); ++i) {
+    const QString &path = m_frames[i].originalPath;
+    if (!m_pendingReloads.contains(path))
+      continue;
+
+    // Files replaced by rename drop out of the watcher
+    if (!QFileInfo::exists(path))
+      continue;
+    if (!m_fileWatcher->files().contains(path))
+      m_fileWatcher->addPath(path);
+
+    ReloadJob job;
+    job.index = i;
+    job.path = path;
+    job.previousHash = m_frames[i].sourceHash;
+    jobs.append(job);
+  }
+  m_pendingReloads.clear();
+
+  if (jobs.isEmpty())
+    return;
+
+  const bool indexed = m_indexedFrames;
+  m_reloadWatcher = new QFutureWatcher<ReloadJob>(this);
+  connect(m_reloadWatcher, &QFutureWatcher<ReloadJob>::finished, this,
+          &ImageSequence::onReloadFinished);
+  m_reloadWatcher->setFuture(
+      QtConcurrent::mapped(jobs, [indexed](ReloadJob job) {
+        QImage img = decodeFrame(job.path, &job.hash);
+        if (job.previousHash == 0 || job.hash != job.previousHash) {
+          job.image = indexed ? toIndexedFrame(img) : img;
+          job.colors = ColorPresence::fromImage(job.image);
+        }
+        return job;
+      }));
+}
+
+void ImageSequence::onReloadFinished() {
+  const QList<ReloadJob> jobs = m_reloadWatcher->future().results();
+  m_reloadWatcher->deleteLater();
+  m_reloadWatcher = nullptr;
+
+  QList<int> reloaded;
+  for (const ReloadJob &job : jobs) {
+    if (job.image.isNull() || job.index >= m_frames.size() ||
+        m_frames[job.index].originalPath != job.path)
+      continue;
+
+    // Never overwrite local edits; flag them instead
+    Frame &frame = m_frames[job.index];
+    if (frame.dirty) {
+      frame.reloadConflict = true;
+      emit reloadConflict(job.index, job.path);
+      continue;
+    }
+
+    frame.sourceHash = job.hash;
+    frame.size = job.image.size();
+    frame.colors = job.colors;
+    if (m_lazyFrames) {
+      QMutexLocker locker(&m_frameCacheMutex);
+      m_frameCache.insert(job.index, new QImage(job.image),
+                          job.image.sizeInBytes());
+    } else {
+      frame.image = job.image;
+    }
+
+    reloaded.append(job.index);
+    emit imageModified(job.index, job.image);
+    if (job.index == m_currentIndex)
+      emit currentImageChanged(job.image);
+  }
+
+  if (!reloaded.isEmpty())
+    emit framesReloaded(reloaded);
+}
+
+void ImageSequence::abortReload() {
+  m_reloadTimer->stop();
+  if (!m_reloadWatcher)
+    return;
+
+  m_reloadWatcher->disconnect(this);
+  m_reloadWatcher->waitForFinished();
+  m_reloadWatcher->deleteLater();
+  m_reloadWatcher = nullptr;
+}
+
+void ImageSequence::setFrameCacheBudget(qint64 bytes) {
+  m_frameCacheBudget = qMax<qint64>(0, bytes);
+
+  // Resize the live cache; switching residency mode waits for the next load
+  QMutexLocker locker(&m_frameCacheMutex);
+  if (m_lazyFrames && m_frameCacheBudget > 0)
+    m_frameCache.setMaxCost(m_frameCacheBudget);
+}
+
+qint64 ImageSequence::frameCacheBudget() const { return m_frameCacheBudget; }
+
+void ImageSequence::setIndexedStorage(bool enabled) {
+  m_indexedStorage = enabled;
+}
+
+bool ImageSequence::indexedStorage() const { return m_indexedStorage; }
+
+void ImageSequence::setSequenceCacheEnabled(bool enabled) {
+  m_sequenceCacheEnabled = enabled;
+}
+
+bool ImageSequence::sequenceCacheEnabled() const {
+  return m_sequenceCacheEnabled;
+}
+
+// Returns the pixels of a frame, decoding lazy frames through the LRU cache.
+// Safe to call from worker threads.
+QImage ImageSequence::frameImage(int index) const {
+  const Frame &frame = m_frames[index];
+  if (!frame.image.isNull() || !m_lazyFrames)
+    return frame.image;
+
+  {
+    QMutexLocker locker(&m_frameCacheMutex);
+    if (QImage *cached = m_frameCache.object(index))
+      return *cached;
+  }
+
+  // Decode outside the lock so other frames can be served meanwhile
+  QImage img;
+  if (m_sequenceCache)
+    img = m_sequenceCache->read(frame.originalPath);
+  if (img.isNull())
+    img = decodeFrame(frame.originalPath);
+  if (m_indexedFrames)
+    img = toIndexedFrame(img);
+  if (!img.isNull()) {
+    QMutexLocker locker(&m_frameCacheMutex);
+    m_frameCache.insert(index, new QImage(img), img.sizeInBytes());
+  }
+  return img;
+}
+
+// Bounding box of the pixels that differ between two versions of a frame; the
+// whole frame if their sizes differ
+static QRect editedRect(const QImage &before, const QImage &after) {
+  if (before.cacheKey() == after.cacheKey())
+    return QRect();
+  if (before.size() != after.size())
+    return after.rect();
+
+  // Same layout: raw bytes compare directly
+  const bool sameLayout = before.format() == after.format() &&
+                          after.depth() >= 8 &&
+                          before.colorTable() == after.colorTable();
+  const QImage a = sameLayout ? before
+                              : before.convertToFormat(QImage::Format_ARGB32);
+  const QImage b = sameLayout ? after
+                              : after.convertToFormat(QImage::Format_ARGB32);
+  const int bpp = b.depth() / 8;
+  const int rowBytes = b.width() * bpp;
+  int left = b.width(), right = -1, top = -1, bottom = -1;
+  for (int y = 0; y < b.height(); ++y) {
+    const uchar *p = a.constScanLine(y);
+    const uchar *q = b.constScanLine(y);
+    if (std::memcmp(p, q, size_t(rowBytes)) == 0)
+      continue;
+    int first = 0;
+    while (p[first] == q[first])
+      ++first;
+    int last = rowBytes - 1;
+    while (p[last] == q[last])
+      --last;
+    left = qMin(left, first / bpp);
+    right = qMax(right, last / bpp);
+    if (top < 0)
+      top = y;
+    bottom = y;
+  }
+  if (right < 0)
+    return QRect();
+  return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+// Replaces the pixels of a frame. Lazy frames become pinned in memory so edits
+// are never evicted.
+void ImageSequence::storeFrameImage(int index, const QImage &image,
+                                    const ColorPresence &colors) {
+  // Edits that had to work in ARGB32 (e.g. painted markers) are re-indexed
+  Frame &frame = m_frames[index];
+  const QImage before = frame.image;
+  frame.image = m_indexedFrames ? toIndexedFrame(image) : image;
+  frame.dirty = true;
+
+  // Cached regions follow the edit by the bounds of the pixels it changed,
+  // so they never need the old pixels kept around
+  QRect edited;
+  bool diffed = false;
+  for (RegionCache *cache : {&frame.guideRegions, &frame.alphaRegions}) {
+    if (!cache->key || before.isNull() ||
+        cache->imageKey != before.cacheKey())
+      continue;
+    if (!diffed) {
+      edited = editedRect(before, frame.image);
+      diffed = true;
+    }
+    cache->edited |= edited;
+    cache->imageKey = frame.image.cacheKey();
+  }
+
+  // Palettes index for free; full-colour frames are left for the next batch
+  // operation rather than scanned on the GUI thread
+  if (colors.isValid() || frame.image.format() != QImage::Format_Indexed8)
+    frame.colors = colors;
+  else
+    frame.colors = ColorPresence::fromImage(frame.image);
+  if (m_lazyFrames) {
+    QMutexLocker locker(&m_frameCacheMutex);
+    m_frameCache.remove(index);
   }
 }
 
 QImage ImageSequence::currentImage() const {
   if (m_currentIndex >= 0 && m_currentIndex < m_frames.size()) {
-    return m_frames[m_currentIndex].image;
+    return frameImage(m_currentIndex);
   }
   return QImage();
 }
@@ -179,22 +756,64 @@ QString ImageSequence::currentFilePath() const {
 
 QImage ImageSequence::imageAt(int index) const {
   if (index >= 0 && index < m_frames.size()) {
-    return m_frames[index].image;
+    return frameImage(index);
   }
   return QImage();
 }
 
+// True if a pixel is within tolerance of color on every channel
+static bool imageUsesColor(const QImage &img, QRgb color, int tolerance) {
+  auto near = [color, tolerance](QRgb c) {
+    return qAbs(qRed(c) - qRed(color)) <= tolerance &&
+           qAbs(qGreen(c) - qGreen(color)) <= tolerance &&
+           qAbs(qBlue(c) - qBlue(color)) <= tolerance &&
+           qAbs(qAlpha(c) - qAlpha(color)) <= tolerance;
+  };
+
+  if (img.format() == QImage::Format_Indexed8) {
+    const QVector<QRgb> table = img.colorTable();
+    return std::any_of(table.cbegin(), table.cend(), near);
+  }
+
+  const QImage argb = img.format() == QImage::Format_ARGB32
+                          ? img
+                          : img.convertToFormat(QImage::Format_ARGB32);
+  for (int y = 0; y < argb.height(); ++y) {
+    const QRgb *line = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+    if (std::any_of(line, line + argb.width(), near))
+      return true;
+  }
+  return false;
+}
+
+QList<int> ImageSequence::framesUsingColor(QRgb color, int tolerance) const {
+  QList<int> frames;
+  if (tolerance < 0)
+    return frames;
+
+  for (int i = 0; i < m_frames.size(); ++i) {
+    const ColorPresence &colors = m_frames[i].colors;
+    if (!colors.mayContainNear(color, tolerance))
+      continue;
+
+    // Exact sets are definitive; Bloom hits and unindexed frames are checked
+    if (colors.isExact() || imageUsesColor(frameImage(i), color, tolerance))
+      frames.append(i);
+  }
+  return frames;
+}
+
 void ImageSequence::setCurrentIndex(int index) {
   if (index >= 0 && index < m_frames.size() && index != m_currentIndex) {
     m_currentIndex = index;
     emit currentIndexChanged(m_currentIndex);
-    emit currentImageChanged(m_frames[m_currentIndex].image);
+    emit currentImageChanged(frameImage(m_currentIndex));
   }
 }
 
 void ImageSequence::setImage(int index, const QImage &image) {
   if (index >= 0 && index < m_frames.size()) {
-    m_frames[index].image = image;
+    storeFrameImage(index, image);
     emit imageModified(index, image);
     if (index == m_currentIndex) {
       emit currentImageChanged(image);
@@ -207,82 +826,135 @@ QMap<int, QImage> ImageSequence::replaceColorsInCurrentFrame(const QList<ColorSw
   if (m_currentIndex < 0 || m_currentIndex >= m_frames.size())
     return undoData;
 
-  QImage original = m_frames[m_currentIndex].image;
-  if (replaceColorsInImage(m_frames[m_currentIndex].image, swaps)) {
+  const ColorSwapKernel kernel(swaps);
+  QImage image = frameImage(m_currentIndex);
+  QImage original = image;
+  if (replaceColorsInImage(image, kernel)) {
+    storeFrameImage(m_currentIndex, image);
     undoData.insert(m_currentIndex, original);
-    emit imageModified(m_currentIndex, m_frames[m_currentIndex].image);
-    emit currentImageChanged(m_frames[m_currentIndex].image);
+    emit imageModified(m_currentIndex, image);
+    emit currentImageChanged(image);
   }
   return undoData;
 }
 
 QMap<int, QImage> ImageSequence::replaceColorsInAllFrames(const QList<ColorSwap> &swaps) {
+  // Shared by every worker, which only read it
+  const ColorSwapKernel kernel(swaps);
+  return applyToAllFrames(
+      [&kernel](QImage &image) {
+        return replaceColorsInImage(image, kernel);
+      },
+      [&swaps](const ColorPresence &colors) {
+        for (const ColorSwap &swap : swaps) {
+          if (swap.enabled && colors.mayContainNear(swap.source.rgba(),
+                                                    swap.tolerance, swap.metric))
+            return true;
+        }
+        return false;
+      });
+}
+
+// Frames are independent, so the kernel runs on the thread pool while the
+// caller waits. Storing, undo data and signals then happen here in frame
+// order, exactly as a serial loop would produce them.
+QMap<int, QImage> ImageSequence::applyToAllFrames(
+    const std::function<bool(QImage &)> &kernel,
+    const std::function<bool(const ColorPresence &)> &mayAffect) {
+  struct Result {
+    QImage original;
+    QImage image; // Null if the kernel left the frame alone
+    ColorPresence colors; // Set whenever the frame was decoded
+  };
+
+  QVector<int> indices(m_frames.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  const QList<Result> results = QtConcurrent::blockingMapped<QList<Result>>(
+      indices, [this, &kernel, &mayAffect](int index) {
+        Result result;
+        const ColorPresence &colors = m_frames.at(index).colors;
+        if (mayAffect && colors.isValid() && !mayAffect(colors))
+          return result;
+
+        QImage image = frameImage(index);
+        QImage original = image;
+        if (kernel(image)) {
+          result.original = original;
+          result.image = image;
+          result.colors = ColorPresence::fromImage(image);
+        } else if (!colors.isValid()) {
+          result.colors = ColorPresence::fromImage(image);
+        }
+        return result;
+      });
+
   QMap<int, QImage> undoData;
-  for (int i = 0; i < m_frames.size(); ++i) {
-    QImage original = m_frames[i].image;
-    if (replaceColorsInImage(m_frames[i].image, swaps)) {
-      undoData.insert(i, original);
-      emit imageModified(i, m_frames[i].image);
+  for (int i = 0; i < results.size(); ++i) {
+    if (results[i].image.isNull()) {
+      if (results[i].colors.isValid())
+        m_frames[i].colors = results[i].colors;
+      continue;
     }
+    storeFrameImage(i, results[i].image, results[i].colors);
+    undoData.insert(i, results[i].original);
+    emit imageModified(i, results[i].image);
   }
 
   if (m_currentIndex >= 0 && undoData.contains(m_currentIndex)) {
-    emit currentImageChanged(m_frames[m_currentIndex].image);
+    emit currentImageChanged(frameImage(m_currentIndex));
   }
   return undoData;
 }
 
-bool ImageSequence::replaceColorsInImage(QImage &img,
-                                         const QList<ColorSwap> &swaps) {
-  // Pre-filter enabled swaps
-  QList<ColorSwap> activeSwaps;
-  for (const auto &s : swaps) {
-    if (s.enabled)
-      activeSwaps.append(s);
-  }
+// Frames at least this large are swapped in parallel bands
+static const qint64 ParallelBandPixels = 4096 * 2048;
+static const int BandRows = 128;
 
-  if (activeSwaps.isEmpty())
+bool ImageSequence::replaceColorsInImage(QImage &img,
+                                         const ColorSwapKernel &kernel) {
+  if (kernel.isEmpty())
     return false;
 
+  bool modified = false;
+
+  // Indexed frames only need their palette rewritten
+  if (img.format() == QImage::Format_Indexed8) {
+    QVector<QRgb> table = img.colorTable();
+    for (QRgb &entry : table) {
+      modified |= kernel.map(entry, &entry);
+    }
+    if (modified)
+      img.setColorTable(table);
+    return modified;
+  }
+
   int w = img.width();
   int h = img.height();
 
-  bool modified = false;
+  // Huge single frames are split into scanline bands across the pool
+  if (qint64(w) * h >= ParallelBandPixels) {
+    // Detach once; scanLine() from several threads would race on it
+    uchar *bits = img.bits();
+    const qsizetype stride = img.bytesPerLine();
+    QVector<int> bands;
+    for (int y = 0; y < h; y += BandRows)
+      bands.append(y);
+    std::atomic<bool> anyModified{false};
+    QtConcurrent::blockingMap(bands, [&](int top) {
+      bool bandModified = false;
+      for (int y = top; y < qMin(top + BandRows, h); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(bits + y * stride);
+        bandModified |= kernel.apply(line, w);
+      }
+      if (bandModified)
+        anyModified = true;
+    });
+    return anyModified;
+  }
+
   for (int y = 0; y < h; ++y) {
     QRgb *line = reinterpret_cast<QRgb *>(img.scanLine(y));
-    for (int x = 0; x < w; ++x) {
-      QRgb current = line[x];
-
-      for (const auto &swap : activeSwaps) {
-        bool match = false;
-        if (swap.tolerance == 0) {
-          if (current == swap.source.rgba()) {
-            match = true;
-          }
-        } else {
-          int r = qRed(current);
-          int g = qGreen(current);
-          int b = qBlue(current);
-          int a = qAlpha(current);
-
-          int sr = swap.source.red();
-          int sg = swap.source.green();
-          int sb = swap.source.blue();
-          int sa = swap.source.alpha();
-
-          if (abs(r - sr) <= swap.tolerance && abs(g - sg) <= swap.tolerance &&
-              abs(b - sb) <= swap.tolerance && abs(a - sa) <= swap.tolerance) {
-            match = true;
-          }
-        }
-
-        if (match) {
-          line[x] = swap.dest.rgba();
-          modified = true;
-          break;
-        }
-      }
-    }
+    modified |= kernel.apply(line, w);
   }
   return modified;
 }
@@ -299,245 +971,878 @@ static bool colorsMatch(const QColor &c1, const QColor &c2, int tolerance) {
          qAbs(b1 - b2) <= tolerance && qAbs(a1 - a2) <= tolerance;
 }
 
-// Helper to process a single image
-static bool processGuideCheckOnImage(QImage &img,
-                                     const QList<GuideColorParams> &params) {
-  if (params.isEmpty())
-    return false;
-
-  QImage resultImg = img.copy();
-  QPainter painter(&resultImg);
-  painter.setRenderHint(QPainter::Antialiasing);
-  bool modified = false;
-
-  int w = img.width();
-  int h = img.height();
-  QVector<bool> visited(w * h, false);
-  QList<QPoint> queue;
+static bool guideColorMatches(const GuideColorParams &p,
+                              const ColorMatcher &matcher, QRgb color) {
+  if (matcher.isBox())
+    return colorsMatch(QColor::fromRgba(color), p.sourceColor, p.tolerance);
+  return matcher.matches(color);
+}
 
-  for (const auto &p : params) {
-    if (!p.enabled)
-      continue;
+// Evaluates a colour test once per run of identical pixels (or once per
+// palette entry) and returns the row-major mask of pixels that pass. Tests
+// may also return a class key instead of a bool; the mask then holds it.
+template <typename Test>
+static QVector<uchar> matchMask(const QImage &img, Test test) {
+  const int w = img.width();
+  const int h = img.height();
+  QVector<uchar> mask(qsizetype(w) * h, 0);
+
+  if (img.format() == QImage::Format_Indexed8) {
+    uchar passes[256] = {};
+    const QVector<QRgb> table = img.colorTable();
+    for (int i = 0; i < table.size() && i < 256; ++i)
+      passes[i] = uchar(test(table[i]));
 
-    std::fill(visited.begin(), visited.end(),
-              false); // Reset visited for each param?
-    // Logic check: if visited is shared across params, blobs might interfere
-    // if they overlap? Original code: `QVector<bool> visited(w * h, false);`
-    // calculated once PER IMAGE? Wait. Original code declared `visited`
-    // INSIDE the params loop: `for (const auto &p : params) { ...
-    // QVector<bool> visited ... }` So yes, it resets for each color check. My
-    // static helper should follow that.
+    for (int y = 0; y < h; ++y) {
+      uchar *row = mask.data() + qsizetype(y) * w;
+      IndexSpanIterator spans(img.constScanLine(y), w);
+      IndexSpan span;
+      while (spans.next(&span)) {
+        if (passes[span.index])
+          std::fill(row + span.x, row + span.x + span.length,
+                    passes[span.index]);
+      }
+    }
+    return mask;
   }
 
-  // Actually, let's copy the code logic exactly.
-  for (const auto &p : params) {
-    if (!p.enabled)
-      continue;
+  const QImage argb = img.format() == QImage::Format_ARGB32
+                          ? img
+                          : img.convertToFormat(QImage::Format_ARGB32);
+  for (int y = 0; y < h; ++y) {
+    uchar *row = mask.data() + qsizetype(y) * w;
+    SpanIterator spans(reinterpret_cast<const QRgb *>(argb.constScanLine(y)),
+                       w);
+    PixelSpan span;
+    while (spans.next(&span)) {
+      if (const uchar key = uchar(test(span.color)))
+        std::fill(row + span.x, row + span.x + span.length, key);
+    }
+  }
+  return mask;
+}
 
-    int w = img.width();
-    int h = img.height();
-    QVector<bool> visited(w * h, false);
-    QList<QPoint> queue;
+// Bounding box of the pixels whose class differs between two versions of a
+// frame of the same size. Unchanged rows cost one memcmp; only the pixels
+// that differ are classified.
+static QRect changedRect(const QImage &before, const QImage &after,
+                         const std::function<uchar(QRgb)> &classify) {
+  if (before.cacheKey() == after.cacheKey())
+    return QRect();
+
+  const int w = after.width();
+  const int h = after.height();
+  int left = w, right = -1, top = -1, bottom = -1;
+  auto include = [&](int x, int y) {
+    left = qMin(left, x);
+    right = qMax(right, x);
+    if (top < 0)
+      top = y;
+    bottom = y;
+  };
+
+  // Same palette: indices compare directly and classify once per entry
+  if (before.format() == QImage::Format_Indexed8 &&
+      after.format() == QImage::Format_Indexed8 &&
+      before.colorTable() == after.colorTable()) {
+    uchar classes[256] = {};
+    const QVector<QRgb> table = after.colorTable();
+    for (int i = 0; i < table.size() && i < 256; ++i)
+      classes[i] = classify(table[i]);
 
     for (int y = 0; y < h; ++y) {
+      const uchar *a = before.constScanLine(y);
+      const uchar *b = after.constScanLine(y);
+      if (std::memcmp(a, b, size_t(w)) == 0)
+        continue;
       for (int x = 0; x < w; ++x) {
-        if (visited[y * w + x])
-          continue;
+        if (a[x] != b[x] && classes[a[x]] != classes[b[x]])
+          include(x, y);
+      }
+    }
+  } else {
+    const QImage argbBefore =
+        before.format() == QImage::Format_ARGB32
+            ? before
+            : before.convertToFormat(QImage::Format_ARGB32);
+    const QImage argbAfter = after.format() == QImage::Format_ARGB32
+                                 ? after
+                                 : after.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < h; ++y) {
+      const QRgb *a = reinterpret_cast<const QRgb *>(argbBefore.constScanLine(y));
+      const QRgb *b = reinterpret_cast<const QRgb *>(argbAfter.constScanLine(y));
+      if (std::memcmp(a, b, size_t(w) * sizeof(QRgb)) == 0)
+        continue;
+      for (int x = 0; x < w; ++x) {
+        if (a[x] != b[x] && classify(a[x]) != classify(b[x]))
+          include(x, y);
+      }
+    }
+  }
 
-        if (colorsMatch(img.pixelColor(x, y), p.sourceColor, p.tolerance)) {
-          // BFS
-          long long sumX = 0, sumY = 0;
-          int count = 0;
-
-          queue.clear();
-          queue.append(QPoint(x, y));
-          visited[y * w + x] = true;
-
-          while (!queue.isEmpty()) {
-            QPoint pt = queue.takeFirst();
-            sumX += pt.x();
-            sumY += pt.y();
-            count++;
-
-            const int dx[] = {1, -1, 0, 0};
-            const int dy[] = {0, 0, 1, -1};
-
-            for (int k = 0; k < 4; ++k) {
-              int nx = pt.x() + dx[k];
-              int ny = pt.y() + dy[k];
-
-              if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
-                if (!visited[ny * w + nx] &&
-                    colorsMatch(img.pixelColor(nx, ny), p.sourceColor,
-                                p.tolerance)) {
-                  visited[ny * w + nx] = true;
-                  queue.append(QPoint(nx, ny));
-                }
-              }
-            }
-          }
+  if (right < 0)
+    return QRect();
+  return QRect(QPoint(left, top), QPoint(right, bottom));
+}
 
-          if (count > 0) {
-            int centerX = sumX / count;
-            int centerY = sumY / count;
-            QPen pen(p.selectionColor);
-            pen.setWidth(p.thickness);
-            painter.setPen(pen);
-            painter.setBrush(Qt::NoBrush);
-            painter.drawEllipse(QPoint(centerX, centerY), p.radius, p.radius);
-            modified = true;
-          }
+QVector<Region>
+ImageSequence::checkRegions(const QImage &img, size_t key,
+                            const std::function<uchar(QRgb)> &classify,
+                            const RegionCache *previous) {
+  RegionLabeler labeler;
+  auto keysOf = [&](const QRect &rect) {
+    return matchMask(rect == img.rect() ? img : img.copy(rect), classify);
+  };
+
+  // A neighbouring frame's regions come with its pixels; a frame's own come
+  // with the bounds of its edits since
+  if (previous && previous->key == key) {
+    if (!previous->image.isNull() && previous->image.size() == img.size())
+      return labeler.relabel(previous->regions, img.size(),
+                             changedRect(previous->image, img, classify),
+                             keysOf);
+    if (previous->image.isNull() && previous->imageKey == img.cacheKey())
+      return labeler.relabel(previous->regions, img.size(), previous->edited,
+                             keysOf);
+  }
+  const QVector<uchar> keys = keysOf(img.rect());
+  return labeler.label(keys.constData(), img.width(), img.height());
+}
+
+// Only what decides the regions; marker styling can change freely
+size_t ImageSequence::guideRegionsKey(const QList<GuideColorParams> &params) {
+  size_t key = 0;
+  for (const GuideColorParams &p : params) {
+    if (p.enabled)
+      key = qHashMulti(key, p.sourceColor.rgba(), p.tolerance, int(p.metric));
+  }
+  return key | 1;
+}
+
+QList<QcMarker> ImageSequence::guideCheckMarkers(
+    const QImage &img, const QList<GuideColorParams> &params) {
+  return guideMarkers(img, params, nullptr, nullptr);
+}
+
+// A circle on the centre of every blob matching an enabled guide colour
+QList<QcMarker> ImageSequence::guideMarkers(
+    const QImage &img, const QList<GuideColorParams> &params,
+    const RegionCache *previous, RegionCache *updated) {
+  QList<QcMarker> markers;
+  if (params.isEmpty() || img.isNull())
+    return markers;
+
+  QList<GuideColorParams> active;
+  QVector<ColorMatcher> matchers;
+  for (const auto &p : params) {
+    if (p.enabled) {
+      active.append(p);
+      matchers.append(
+          ColorMatcher(p.sourceColor.rgba(), p.tolerance, p.metric));
+    }
+  }
+
+  auto addMarker = [&markers](const GuideColorParams &p,
+                              const Region &region) {
+    QcMarker marker;
+    marker.kind = QcMarker::GuideCircle;
+    marker.center = region.center();
+    marker.size = p.radius;
+    marker.thickness = p.thickness;
+    marker.color = p.selectionColor;
+    markers.append(marker);
+  };
+
+  // One pass for all entries: each colour is classified to the entry it
+  // matches and every entry's regions are labelled together. A colour
+  // matching several entries would belong to several regions at once, which
+  // one key plane cannot hold, so that falls back to a pass per entry.
+  bool overlap = active.size() > 255;
+  if (!overlap) {
+    QHash<QRgb, uchar> classes;
+    auto classify = [&](QRgb c) {
+      const auto known = classes.constFind(c);
+      if (known != classes.constEnd())
+        return *known;
+
+      uchar key = 0;
+      for (int i = 0; i < active.size(); ++i) {
+        if (guideColorMatches(active[i], matchers[i], c)) {
+          if (key)
+            overlap = true;
+          else
+            key = uchar(i + 1);
         }
       }
+      classes.insert(c, key);
+      return key;
+    };
+    const size_t key = guideRegionsKey(params);
+    QVector<Region> regions = checkRegions(img, key, classify, previous);
+
+    if (!overlap) {
+      if (updated)
+        *updated = RegionCache{key, img, img.cacheKey(), QRect(), regions};
+
+      // Entry by entry, each in raster order, as separate passes would
+      std::stable_sort(regions.begin(), regions.end(),
+                       [](const Region &a, const Region &b) {
+                         return a.key < b.key;
+                       });
+      for (const Region &region : regions)
+        addMarker(active[region.key - 1], region);
     }
   }
-  painter.end();
 
-  if (modified) {
-    img = resultImg;
+  if (overlap) {
+    RegionLabeler labeler;
+    for (int i = 0; i < active.size(); ++i) {
+      const QVector<uchar> matches = matchMask(img, [&](QRgb c) {
+        return guideColorMatches(active[i], matchers[i], c);
+      });
+      for (const Region &region :
+           labeler.label(matches.constData(), img.width(), img.height()))
+        addMarker(active[i], region);
+    }
   }
-  return modified;
+  return markers;
 }
 
-QMap<int, QImage> ImageSequence::applyGuideCheckToAllFrames(
-    const QList<GuideColorParams> &params) {
-  QMap<int, QImage> undoData;
-  if (params.isEmpty())
-    return undoData;
+// Transparent regions do not depend on the parameters
+static const size_t AlphaRegionsKey = 1;
+
+QList<QcMarker> ImageSequence::alphaCheckMarkers(
+    const QImage &img, const AlphaCheckParams &params) {
+  return alphaMarkers(img, params, nullptr, nullptr);
+}
+
+// A cross on the centre of every fully transparent region
+QList<QcMarker> ImageSequence::alphaMarkers(const QImage &img,
+                                            const AlphaCheckParams &params,
+                                            const RegionCache *previous,
+                                            RegionCache *updated) {
+  QList<QcMarker> markers;
+  if (img.isNull())
+    return markers;
+
+  const QVector<Region> regions = checkRegions(
+      img, AlphaRegionsKey, [](QRgb c) { return uchar(qAlpha(c) == 0); },
+      previous);
+  if (updated)
+    *updated =
+        RegionCache{AlphaRegionsKey, img, img.cacheKey(), QRect(), regions};
+
+  for (const Region &region : regions) {
+    QcMarker marker;
+    marker.kind = QcMarker::AlphaCross;
+    marker.center = region.center();
+    marker.size = params.crossSize;
+    marker.thickness = params.thickness;
+    marker.color = params.crossColor;
+    markers.append(marker);
+  }
+  return markers;
+}
+
+void ImageSequence::paintMarkers(QImage &img, const QList<QcMarker> &markers) {
+  if (markers.isEmpty() || img.isNull())
+    return;
+
+  // QPainter cannot draw into indexed frames
+  if (img.format() != QImage::Format_ARGB32)
+    img = img.convertToFormat(QImage::Format_ARGB32);
+
+  QPainter painter(&img);
+  painter.setBrush(Qt::NoBrush);
+  for (const QcMarker &marker : markers) {
+    QPen pen(marker.color);
+    pen.setWidth(marker.thickness);
+    painter.setPen(pen);
+
+    const QPoint c = marker.center;
+    if (marker.kind != QcMarker::AlphaCross) {
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      painter.drawEllipse(c, marker.size, marker.size);
+    } else {
+      const int halfSize = marker.size / 2;
+      painter.setRenderHint(QPainter::Antialiasing, false);
+      painter.drawLine(c.x() - halfSize, c.y() - halfSize, c.x() + halfSize,
+                       c.y() + halfSize);
+      painter.drawLine(c.x() - halfSize, c.y() + halfSize, c.x() + halfSize,
+                       c.y() - halfSize);
+    }
+  }
+}
+
+QList<QcMarker> ImageSequence::markers(int index) const {
+  if (index < 0 || index >= m_frames.size())
+    return QList<QcMarker>();
+  return m_frames[index].markers;
+}
 
+void ImageSequence::setMarkers(int index, const QList<QcMarker> &markers) {
+  if (index < 0 || index >= m_frames.size())
+    return;
+  m_frames[index].markers = markers;
+  emit markersChanged(index);
+}
+
+QMap<int, QList<QcMarker>> ImageSequence::clearMarkers(bool allFrames) {
+  QMap<int, QList<QcMarker>> previous;
   for (int i = 0; i < m_frames.size(); ++i) {
-    QImage original = m_frames[i].image;
-    if (processGuideCheckOnImage(m_frames[i].image, params)) {
-      undoData.insert(i, original);
-      emit imageModified(i, m_frames[i].image);
+    if ((!allFrames && i != m_currentIndex) || m_frames[i].markers.isEmpty())
+      continue;
+    previous.insert(i, m_frames[i].markers);
+    m_frames[i].markers.clear();
+    emit markersChanged(i);
+  }
+  return previous;
+}
+
+// Frames analysed in order by one worker, each seeded from the one before
+static const int NeighbourRun = 8;
+
+// Detection runs on the thread pool like applyToAllFrames; only the marker
+// lists change, so no pixel data is copied or kept for undo.
+//
+// Consecutive frames go to the same worker, so a frame without regions of its
+// own from the same check relabels from its predecessor's: neighbouring
+// frames of an animation mostly differ in a small area.
+QMap<int, QList<QcMarker>> ImageSequence::applyMarkerCheck(
+    QcMarker::Kind kind, bool allFrames, RegionCache Frame::*cache,
+    size_t key, const MarkerDetect &detect,
+    const std::function<bool(const ColorPresence &)> &mayAffect) {
+  QVector<int> indices;
+  if (allFrames) {
+    indices.resize(m_frames.size());
+    std::iota(indices.begin(), indices.end(), 0);
+  } else if (m_currentIndex >= 0 && m_currentIndex < m_frames.size()) {
+    indices.append(m_currentIndex);
+  }
+
+  struct Found {
+    bool analysed = false;
+    QList<QcMarker> markers;
+    RegionCache regions;
+  };
+  QVector<Found> found(indices.size());
+  Found *results = found.data();
+  QVector<int> runs;
+  for (int i = 0; i < indices.size(); i += NeighbourRun)
+    runs.append(i);
+
+  QtConcurrent::blockingMap(runs, [&](int start) {
+    RegionCache neighbour;
+    const int end = qMin<int>(start + NeighbourRun, indices.size());
+    for (int i = start; i < end; ++i) {
+      const Frame &frame = m_frames.at(indices[i]);
+      if (mayAffect && frame.colors.isValid() && !mayAffect(frame.colors)) {
+        neighbour = RegionCache();
+        continue;
+      }
+
+      const QImage image = frameImage(indices[i]);
+      const RegionCache *previous = nullptr;
+      if (cache && (frame.*cache).key == key &&
+          (frame.*cache).imageKey == image.cacheKey())
+        previous = &(frame.*cache);
+      else if (cache && neighbour.key == key)
+        previous = &neighbour;
+
+      Found &result = results[i];
+      result.analysed = true;
+      result.markers = detect(image, previous, &result.regions);
+      neighbour = result.regions;
     }
+  });
+
+  QMap<int, QList<QcMarker>> previous;
+  for (int i = 0; i < indices.size(); ++i) {
+    if (cache && found[i].analysed) {
+      RegionCache &stored = m_frames[indices[i]].*cache;
+      stored = m_lazyFrames ? RegionCache() : found[i].regions;
+      stored.image = QImage();
+    }
+    replaceMarkers(indices[i], kind, found[i].markers, previous);
   }
+  return previous;
+}
 
-  if (m_currentIndex >= 0 && undoData.contains(m_currentIndex)) {
-    emit currentImageChanged(m_frames[m_currentIndex].image);
+void ImageSequence::replaceMarkers(int index, QcMarker::Kind kind,
+                                   const QList<QcMarker> &found,
+                                   QMap<int, QList<QcMarker>> &previous) {
+  Frame &frame = m_frames[index];
+  QList<QcMarker> kept;
+  bool hadKind = false;
+  for (const QcMarker &marker : frame.markers) {
+    if (marker.kind == kind)
+      hadKind = true;
+    else
+      kept.append(marker);
   }
-  return undoData;
+  if (!hadKind && found.isEmpty())
+    return;
+
+  previous.insert(index, frame.markers);
+  frame.markers = kept + found;
+  emit markersChanged(index);
+}
+
+static bool mayContainGuideColor(const QList<GuideColorParams> &params,
+                                 const ColorPresence &colors) {
+  for (const GuideColorParams &p : params) {
+    if (p.enabled &&
+        colors.mayContainNear(p.sourceColor.rgba(), p.tolerance, p.metric))
+      return true;
+  }
+  return false;
 }
 
-QMap<int, QImage> ImageSequence::applyGuideCheckToCurrentFrame(
+QMap<int, QList<QcMarker>> ImageSequence::applyGuideCheckToAllFrames(
     const QList<GuideColorParams> &params) {
-  QMap<int, QImage> undoData;
-  if (params.isEmpty() || m_currentIndex < 0 ||
-      m_currentIndex >= m_frames.size())
-    return undoData;
+  if (params.isEmpty())
+    return QMap<int, QList<QcMarker>>();
+
+  return applyMarkerCheck(
+      QcMarker::GuideCircle, true, &Frame::guideRegions,
+      guideRegionsKey(params),
+      [&params](const QImage &image, const RegionCache *previous,
+                RegionCache *updated) {
+        return guideMarkers(image, params, previous, updated);
+      },
+      [&params](const ColorPresence &colors) {
+        return mayContainGuideColor(params, colors);
+      });
+}
 
-  QImage original = m_frames[m_currentIndex].image;
-  if (processGuideCheckOnImage(m_frames[m_currentIndex].image, params)) {
-    undoData.insert(m_currentIndex, original);
-    emit imageModified(m_currentIndex, m_frames[m_currentIndex].image);
-    emit currentImageChanged(m_frames[m_currentIndex].image);
-  }
-  return undoData;
+QMap<int, QList<QcMarker>> ImageSequence::applyGuideCheckToCurrentFrame(
+    const QList<GuideColorParams> &params) {
+  if (params.isEmpty())
+    return QMap<int, QList<QcMarker>>();
+
+  return applyMarkerCheck(
+      QcMarker::GuideCircle, false, &Frame::guideRegions,
+      guideRegionsKey(params),
+      [&params](const QImage &image, const RegionCache *previous,
+                RegionCache *updated) {
+        return guideMarkers(image, params, previous, updated);
+      });
 }
 
-// Helper for Alpha Check
-static bool processAlphaCheckOnImage(QImage &img,
-                                     const AlphaCheckParams &params) {
+QMap<int, QList<QcMarker>>
+ImageSequence::applyAlphaCheckToAllFrames(const AlphaCheckParams &params) {
+  return applyMarkerCheck(
+      QcMarker::AlphaCross, true, &Frame::alphaRegions, AlphaRegionsKey,
+      [&params](const QImage &image, const RegionCache *previous,
+                RegionCache *updated) {
+        return alphaMarkers(image, params, previous, updated);
+      },
+      [](const ColorPresence &colors) {
+        return colors.mayContainTransparent();
+      });
+}
+
+QMap<int, QList<QcMarker>>
+ImageSequence::applyAlphaCheckToCurrentFrame(const AlphaCheckParams &params) {
+  return applyMarkerCheck(
+      QcMarker::AlphaCross, false, &Frame::alphaRegions, AlphaRegionsKey,
+      [&params](const QImage &image, const RegionCache *previous,
+                RegionCache *updated) {
+        return alphaMarkers(image, params, previous, updated);
+      });
+}
+
+static QVector<Region> findSpecks(const QImage &img,
+                                  const SpeckCleanupParams &params) {
+  QVector<Region> specks;
   if (img.isNull())
-    return false;
+    return specks;
 
-  int w = img.width();
-  int h = img.height();
-  QVector<bool> visited(w * h, false);
-  QList<QPoint> queue;
-  bool modified = false;
+  const int maxArea = qBound(1, params.maxArea, SpeckCleanupParams::MaxArea);
+  RegionLabeler labeler;
+  for (const Region &region : labeler.labelColors(img)) {
+    if (region.area <= maxArea)
+      specks.append(region);
+  }
+  return specks;
+}
 
-  QPainter painter(&img);
-  QPen pen(params.crossColor);
-  pen.setWidth(params.thickness);
-  painter.setPen(pen);
+QList<QcMarker> ImageSequence::speckMarkers(const QImage &img,
+                                            const SpeckCleanupParams &params) {
+  QList<QcMarker> markers;
+  for (const Region &region : findSpecks(img, params)) {
+    QcMarker marker;
+    marker.kind = QcMarker::SpeckCircle;
+    marker.center = region.center();
+    marker.size = params.markerRadius;
+    marker.thickness = params.thickness;
+    marker.color = params.markerColor;
+    markers.append(marker);
+  }
+  return markers;
+}
 
-  for (int y = 0; y < h; ++y) {
-    for (int x = 0; x < w; ++x) {
-      if (visited[y * w + x])
-        continue;
+bool ImageSequence::absorbSpecks(QImage &img,
+                                 const SpeckCleanupParams &params) {
+  const QVector<Region> specks = findSpecks(img, params);
+  if (specks.isEmpty())
+    return false;
 
-      // Check if pixel is fully transparent
-      if (img.pixelColor(x, y).alpha() == 0) {
-        // Found a new alpha region
-        visited[y * w + x] = true;
-        queue.clear();
-        queue.append(QPoint(x, y));
-
-        long long sumX = 0;
-        long long sumY = 0;
-        int count = 0;
-
-        while (!queue.isEmpty()) {
-          QPoint p = queue.takeFirst();
-          sumX += p.x();
-          sumY += p.y();
-          count++;
-
-          // Neighbors (4-connected)
-          const int dx[] = {0, 0, 1, -1};
-          const int dy[] = {1, -1, 0, 0};
-
-          for (int i = 0; i < 4; ++i) {
-            int nx = p.x() + dx[i];
-            int ny = p.y() + dy[i];
-
-            if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
-              if (!visited[ny * w + nx] &&
-                  img.pixelColor(nx, ny).alpha() == 0) {
-                visited[ny * w + nx] = true;
-                queue.append(QPoint(nx, ny));
-              }
-            }
-          }
+  // Decisions read the frame as it was, so the result does not depend on the
+  // order specks are filled in
+  const QImage source = img.format() == QImage::Format_ARGB32
+                            ? img
+                            : img.convertToFormat(QImage::Format_ARGB32);
+  QImage result = source;
+  QRgb *bits = reinterpret_cast<QRgb *>(result.bits());
+  const qsizetype stride = result.bytesPerLine() / sizeof(QRgb);
+  const int w = source.width();
+  const int h = source.height();
+  auto pixel = [&source](int x, int y) {
+    return reinterpret_cast<const QRgb *>(source.constScanLine(y))[x];
+  };
+
+  const int dx[] = {1, -1, 0, 0};
+  const int dy[] = {0, 0, 1, -1};
+  bool modified = false;
+  QVector<QPoint> members;
+  QVector<uchar> visited; // Over the speck's bounds
+  QVector<QPair<QRgb, int>> neighbours;
+  for (const Region &speck : specks) {
+    // The speck's pixels, by a flood bounded by its area and bounds
+    const QRect &box = speck.bounds;
+    auto seen = [&](const QPoint &p) -> uchar & {
+      return visited[(p.y() - box.top()) * box.width() + p.x() - box.left()];
+    };
+    const QRgb color = pixel(speck.firstPixel.x(), speck.firstPixel.y());
+    visited.fill(0, qsizetype(box.width()) * box.height());
+    members = {speck.firstPixel};
+    seen(speck.firstPixel) = 1;
+    // Palette entries sharing a colour can join specks across indices; such
+    // a flood leaves the bounds or outgrows the area
+    bool joined = false;
+    for (int i = 0; i < members.size() && !joined; ++i) {
+      for (int k = 0; k < 4 && !joined; ++k) {
+        const QPoint n(members[i].x() + dx[k], members[i].y() + dy[k]);
+        if (n.x() < 0 || n.x() >= w || n.y() < 0 || n.y() >= h ||
+            pixel(n.x(), n.y()) != color)
+          continue;
+        if (!box.contains(n)) {
+          joined = true;
+        } else if (!seen(n)) {
+          seen(n) = 1;
+          members.append(n);
+          joined = members.size() > speck.area;
         }
+      }
+    }
+    if (joined || members.size() != speck.area)
+      continue;
 
-        // Draw crosshair at center of mass
-        if (count > 0) {
-          int centerX = sumX / count;
-          int centerY = sumY / count;
-          int halfSize = params.crossSize / 2;
-
-          painter.drawLine(centerX - halfSize, centerY - halfSize,
-                           centerX + halfSize, centerY + halfSize);
-          painter.drawLine(centerX - halfSize, centerY + halfSize,
-                           centerX + halfSize, centerY - halfSize);
-          modified = true;
-        }
+    neighbours.clear();
+    for (const QPoint &p : members) {
+      for (int k = 0; k < 4; ++k) {
+        const int nx = p.x() + dx[k];
+        const int ny = p.y() + dy[k];
+        if (nx < 0 || nx >= w || ny < 0 || ny >= h)
+          continue;
+        const QRgb c = pixel(nx, ny);
+        if (c == color)
+          continue;
+        auto it = std::find_if(neighbours.begin(), neighbours.end(),
+                               [c](const QPair<QRgb, int> &n) {
+                                 return n.first == c;
+                               });
+        if (it != neighbours.end())
+          ++it->second;
+        else
+          neighbours.append({c, 1});
       }
     }
+    if (neighbours.isEmpty())
+      continue;
+
+    QRgb fill = neighbours.first().first;
+    int best = neighbours.first().second;
+    for (const auto &n : neighbours) {
+      if (n.second > best) {
+        best = n.second;
+        fill = n.first;
+      }
+    }
+    for (const QPoint &p : members)
+      bits[p.y() * stride + p.x()] = fill;
+    modified = true;
   }
 
-  painter.end();
+  if (modified)
+    img = result;
   return modified;
 }
 
-QMap<int, QImage> ImageSequence::applyAlphaCheckToAllFrames(const AlphaCheckParams &params) {
+QMap<int, QList<QcMarker>>
+ImageSequence::markSpecksInAllFrames(const SpeckCleanupParams &params) {
+  return applyMarkerCheck(QcMarker::SpeckCircle, true, nullptr, 0,
+                          [&params](const QImage &image, const RegionCache *,
+                                    RegionCache *) {
+                            return speckMarkers(image, params);
+                          });
+}
+
+QMap<int, QList<QcMarker>>
+ImageSequence::markSpecksInCurrentFrame(const SpeckCleanupParams &params) {
+  return applyMarkerCheck(QcMarker::SpeckCircle, false, nullptr, 0,
+                          [&params](const QImage &image, const RegionCache *,
+                                    RegionCache *) {
+                            return speckMarkers(image, params);
+                          });
+}
+
+QMap<int, QImage>
+ImageSequence::absorbSpecksInAllFrames(const SpeckCleanupParams &params) {
+  return applyToAllFrames(
+      [&params](QImage &image) { return absorbSpecks(image, params); });
+}
+
+QMap<int, QImage>
+ImageSequence::absorbSpecksInCurrentFrame(const SpeckCleanupParams &params) {
   QMap<int, QImage> undoData;
-  for (int i = 0; i < m_frames.size(); ++i) {
-    QImage original = m_frames[i].image;
-    if (processAlphaCheckOnImage(m_frames[i].image, params)) {
-      undoData.insert(i, original);
-      emit imageModified(i, m_frames[i].image);
-    }
-  }
-  if (m_currentIndex >= 0 && undoData.contains(m_currentIndex)) {
-    emit currentImageChanged(m_frames[m_currentIndex].image);
+  if (m_currentIndex < 0 || m_currentIndex >= m_frames.size())
+    return undoData;
+
+  QImage image = frameImage(m_currentIndex);
+  QImage original = image;
+  if (absorbSpecks(image, params)) {
+    storeFrameImage(m_currentIndex, image);
+    undoData.insert(m_currentIndex, original);
+    emit imageModified(m_currentIndex, image);
+    emit currentImageChanged(image);
   }
   return undoData;
 }
 
-QMap<int, QImage> ImageSequence::applyAlphaCheckToCurrentFrame(
-    const AlphaCheckParams &params) {
+// Key plane of the regions enclosed by line art: 1 off the lines, 0 on them
+static QVector<uchar> lineArtKeys(const QImage &img,
+                                  const PropagationParams &params) {
+  const ColorMatcher line(params.lineColor.rgba(), params.lineTolerance,
+                          ColorMetric::PerChannel);
+  return matchMask(img, [&line](QRgb c) { return !line.matches(c); });
+}
+
+// A runner-up this close to the best match with another colour makes the
+// match a coin toss
+static const double AmbiguityMargin = 0.1;
+
+// Labelling, matching and painting run on the thread pool, each frame or
+// pair of frames on its own; only handing colours down the matches is
+// serial, and that touches no pixels.
+QMap<int, QImage>
+ImageSequence::propagateColors(const PropagationParams &params,
+                               QMap<int, QList<QcMarker>> *previousMarkers) {
   QMap<int, QImage> undoData;
-  if (m_currentIndex < 0 || m_currentIndex >= m_frames.size())
+  const int key = params.keyFrame;
+  const int last = params.lastFrame < 0
+                       ? int(m_frames.size()) - 1
+                       : qMin(params.lastFrame, int(m_frames.size()) - 1);
+  if (key < 0 || key >= last)
     return undoData;
 
-  QImage original = m_frames[m_currentIndex].image;
-  if (processAlphaCheckOnImage(m_frames[m_currentIndex].image, params)) {
-    undoData.insert(m_currentIndex, original);
-    emit imageModified(m_currentIndex, m_frames[m_currentIndex].image);
-    emit currentImageChanged(m_frames[m_currentIndex].image);
+  // Regions of every frame, and the colours of the key frame's. The runs of
+  // the following frames' regions are kept for painting; they are far
+  // smaller than label maps and spare labelling every frame twice.
+  struct Analysis {
+    QVector<Region> regions;
+    QVector<RegionLabeler::RegionRun> runs;
+    QVector<QRgb> colors;
+  };
+  QVector<int> indices(last - key + 1);
+  std::iota(indices.begin(), indices.end(), key);
+  const QList<Analysis> analyses =
+      QtConcurrent::blockingMapped<QList<Analysis>>(
+          indices, [this, &params, key](int index) {
+            Analysis analysis;
+            const QImage image = frameImage(index);
+            if (image.isNull())
+              return analysis;
+            const QVector<uchar> keys = lineArtKeys(image, params);
+            RegionLabeler labeler;
+            analysis.regions =
+                labeler.label(keys.constData(), image.width(), image.height());
+            if (index == key) {
+              analysis.colors = RegionMatcher::dominantColors(
+                  image, labeler.labelMap(), analysis.regions.size());
+            } else {
+              analysis.runs = labeler.regionRuns();
+            }
+            return analysis;
+          });
+
+  // Every frame against the one before it
+  QVector<int> pairs(indices.size() - 1);
+  std::iota(pairs.begin(), pairs.end(), 1);
+  const QList<QVector<RegionMatcher::Candidate>> candidates =
+      QtConcurrent::blockingMapped<QList<QVector<RegionMatcher::Candidate>>>(
+          pairs, [&analyses, &params](int i) {
+            return RegionMatcher::match(analyses[i - 1].regions,
+                                        analyses[i].regions, params.minArea,
+                                        params.maxCost);
+          });
+
+  // Colours follow the matches frame by frame
+  QVector<QVector<QRgb>> colors(indices.size());
+  QVector<QVector<bool>> known(indices.size());
+  QVector<QList<QcMarker>> review(indices.size());
+  colors[0] = analyses[0].colors;
+  known[0].fill(true, colors[0].size());
+  for (int i = 1; i < indices.size(); ++i) {
+    const QVector<Region> &regions = analyses[i].regions;
+    colors[i].fill(0, regions.size());
+    known[i].fill(false, regions.size());
+    for (int r = 0; r < regions.size(); ++r) {
+      if (regions[r].area < params.minArea)
+        continue;
+
+      const RegionMatcher::Candidate &c = candidates[i - 1][r];
+      const bool matched = c.best >= 0 && known[i - 1][c.best];
+      const bool ambiguous =
+          matched && c.runnerUp >= 0 &&
+          c.runnerUpCost - c.bestCost < AmbiguityMargin &&
+          (!known[i - 1][c.runnerUp] ||
+           colors[i - 1][c.runnerUp] != colors[i - 1][c.best]);
+      if (matched && !ambiguous) {
+        known[i][r] = true;
+        colors[i][r] = colors[i - 1][c.best];
+        continue;
+      }
+
+      QcMarker marker;
+      marker.kind = QcMarker::ReviewCircle;
+      marker.center = regions[r].center();
+      marker.size = params.markerRadius;
+      marker.thickness = params.thickness;
+      marker.color = params.markerColor;
+      review[i].append(marker);
+    }
+  }
+
+  // Paint the following frames; the key frame keeps its pixels
+  struct Result {
+    QImage original;
+    QImage image; // Null if no pixel changed
+  };
+  const QList<Result> results = QtConcurrent::blockingMapped<QList<Result>>(
+      pairs, [this, &indices, &analyses, &colors, &known](int i) {
+        Result result;
+        const QImage original = frameImage(indices[i]);
+        if (original.isNull() || !known[i].contains(true))
+          return result;
+
+        QImage image = original.convertToFormat(QImage::Format_ARGB32);
+        // Detach once rather than on every scanLine()
+        uchar *bits = image.bits();
+        const qsizetype stride = image.bytesPerLine();
+        bool modified = false;
+        for (const RegionLabeler::RegionRun &run : analyses[i].runs) {
+          if (!known[i][run.region])
+            continue;
+          const QRgb color = colors[i][run.region];
+          QRgb *row = reinterpret_cast<QRgb *>(bits + run.y * stride);
+          for (int x = run.x0; x < run.x1; ++x) {
+            if (row[x] != color) {
+              row[x] = color;
+              modified = true;
+            }
+          }
+        }
+        if (modified) {
+          result.original = original;
+          result.image = image;
+        }
+        return result;
+      });
+
+  QMap<int, QList<QcMarker>> previous;
+  for (int i = 1; i < indices.size(); ++i) {
+    const int index = indices[i];
+    const Result &result = results[i - 1];
+    if (!result.image.isNull()) {
+      storeFrameImage(index, result.image);
+      undoData.insert(index, result.original);
+      emit imageModified(index, result.image);
+    }
+    replaceMarkers(index, QcMarker::ReviewCircle, review[i], previous);
   }
+  if (undoData.contains(m_currentIndex))
+    emit currentImageChanged(frameImage(m_currentIndex));
+
+  if (previousMarkers)
+    *previousMarkers = previous;
   return undoData;
 }
+
+// The interactive path: only the filled box is copied for undo, and the
+// colour index is left for the next batch operation as other edits do
+QMap<int, FramePatch> ImageSequence::fillFrames(int first, int last,
+                                                const FillParams &params) {
+  struct Result {
+    QImage image; // Null if nothing changed
+    FramePatch before;
+  };
+
+  QVector<int> indices;
+  for (int i = qMax(0, first); i <= qMin(last, int(m_frames.size()) - 1); ++i)
+    indices.append(i);
+
+  const QList<Result> results = QtConcurrent::blockingMapped<QList<Result>>(
+      indices, [this, &params](int index) {
+        Result result;
+        const QImage original = frameImage(index);
+        QImage image = original;
+        FloodFill filler;
+        const QRect filled = filler.fill(image, params);
+        if (filled.isEmpty())
+          return result;
+
+        result.image = image;
+        result.before.rect = filled;
+        result.before.image =
+            original.copy(filled).convertToFormat(QImage::Format_ARGB32);
+        return result;
+      });
+
+  QMap<int, FramePatch> undoData;
+  for (int i = 0; i < results.size(); ++i) {
+    if (results[i].image.isNull())
+      continue;
+    const int index = indices[i];
+    storeFrameImage(index, results[i].image);
+    undoData.insert(index, results[i].before);
+    emit imageModified(index, results[i].image);
+    if (index == m_currentIndex)
+      emit currentImageChanged(results[i].image);
+  }
+  return undoData;
+}
+
+FramePatch ImageSequence::applyPatch(int index, const FramePatch &patch) {
+  FramePatch covered;
+  if (index < 0 || index >= m_frames.size() || patch.image.isNull())
+    return covered;
+
+  QImage image = frameImage(index);
+  if (!image.rect().contains(patch.rect))
+    return covered;
+  if (image.format() != QImage::Format_ARGB32)
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+  covered.rect = patch.rect;
+  covered.image = image.copy(patch.rect);
+  const qsizetype rowBytes = qsizetype(patch.rect.width()) * sizeof(QRgb);
+  for (int y = 0; y < patch.rect.height(); ++y) {
+    uchar *row = image.scanLine(patch.rect.top() + y) +
+                 qsizetype(patch.rect.left()) * sizeof(QRgb);
+    std::memcpy(row, patch.image.constScanLine(y), rowBytes);
+  }
+  setImage(index, image);
+  return covered;
+}
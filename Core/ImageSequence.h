@@ -2,26 +2,73 @@
 #define IMAGESEQUENCE_H
 
 #include "CelPaintTypes.h"
+#include "ColorPresence.h"
+#include "ColorSwapKernel.h"
+#include "RegionLabeler.h"
+#include <QCache>
 #include <QDir>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QList>
 #include <QMap>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QSharedPointer>
 #include <QString>
+#include <QTimer>
 #include <QtGui/QColor>
+#include <functional>
+
+class SequenceCache;
 
 class ImageSequence : public QObject {
   Q_OBJECT
   Q_PROPERTY(int currentIndex READ currentIndex WRITE setCurrentIndex NOTIFY
                  currentIndexChanged)
   Q_PROPERTY(int count READ count NOTIFY countChanged)
+  Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
 
 public:
   explicit ImageSequence(QObject *parent = nullptr);
+  ~ImageSequence() override;
 
   // File Operations
+  // Frames are decoded on the global thread pool. They are appended in file
+  // order as they become available; sequenceLoaded() fires once all are done.
   void loadSequence(const QStringList &filePaths);
-  void saveSequence(const QString &outputDir, const QString &format = "PNG");
+  void cancelLoading();
+  bool isLoading() const;
+  // Frames are written on the global thread pool, each to a temporary file
+  // that is renamed into place once complete. An empty format keeps each
+  // frame's source format and file name. With modifiedOnly, only frames edited
+  // since they were loaded or last saved are written. An export still running
+  // is completed and reported with saveFinished() first.
+  void saveSequence(const QString &outputDir,
+                    const QString &format = QString(),
+                    bool modifiedOnly = false);
+  bool isSaving() const;
+  int modifiedCount() const;
+
+  // Frame residency. A budget of 0 keeps every decoded frame in memory.
+  // Otherwise frames only keep their path and size, are decoded on demand and
+  // held in an LRU cache limited to the budget. Edited frames are pinned in
+  // memory until the next load. The mode is chosen when a sequence is loaded.
+  void setFrameCacheBudget(qint64 bytes);
+  qint64 frameCacheBudget() const;
+
+  // Indexed storage keeps frames with at most 256 colours as Format_Indexed8
+  // with a per-frame palette, a quarter of the ARGB32 footprint. Frames with
+  // more colours stay ARGB32. Chosen when a sequence is loaded.
+  void setIndexedStorage(bool enabled);
+  bool indexedStorage() const;
+
+  // Sequence cache: decoded frames are packed into a sidecar file next to the
+  // sequence and reused on reopen for sources whose size and mtime are
+  // unchanged. The sidecar is rewritten after a load that had to decode.
+  void setSequenceCacheEnabled(bool enabled);
+  bool sequenceCacheEnabled() const;
 
   // Image Access
   QImage currentImage() const;
@@ -30,6 +77,10 @@ public:
   QString currentFilePath() const;
   QImage imageAt(int index) const;
 
+  // Frames with a pixel within tolerance of color on every channel. Answered
+  // from the per-frame colour index; only ambiguous frames are scanned.
+  QList<int> framesUsingColor(QRgb color, int tolerance = 0) const;
+
   // Manipulation
   void setCurrentIndex(int index);
   void setImage(int index, const QImage &image);
@@ -38,31 +89,244 @@ public:
   QMap<int, QImage> replaceColorsInCurrentFrame(const QList<ColorSwap> &swaps);
   QMap<int, QImage> replaceColorsInAllFrames(const QList<ColorSwap> &swaps);
 
+  // QC markers: checks annotate frames with markers kept beside the pixels
+  // instead of painting into them. Each check replaces the markers of its
+  // own kind and returns the previous lists of the frames it changed.
+  QList<QcMarker> markers(int index) const;
+  void setMarkers(int index, const QList<QcMarker> &markers);
+  QMap<int, QList<QcMarker>> clearMarkers(bool allFrames);
+
   // New Feature: Check Guide Color
-  QMap<int, QImage> applyGuideCheckToAllFrames(const QList<GuideColorParams> &params);
-  QMap<int, QImage> applyGuideCheckToCurrentFrame(const QList<GuideColorParams> &params);
+  QMap<int, QList<QcMarker>>
+  applyGuideCheckToAllFrames(const QList<GuideColorParams> &params);
+  QMap<int, QList<QcMarker>>
+  applyGuideCheckToCurrentFrame(const QList<GuideColorParams> &params);
 
   // New Feature: Alpha Check
-  QMap<int, QImage> applyAlphaCheckToAllFrames(const AlphaCheckParams &params);
-  QMap<int, QImage> applyAlphaCheckToCurrentFrame(const AlphaCheckParams &params);
+  QMap<int, QList<QcMarker>>
+  applyAlphaCheckToAllFrames(const AlphaCheckParams &params);
+  QMap<int, QList<QcMarker>>
+  applyAlphaCheckToCurrentFrame(const AlphaCheckParams &params);
+
+  // Speck cleanup: regions of one colour (including transparent pinholes)
+  // of at most maxArea pixels, found with one colour labelling per frame
+  QMap<int, QList<QcMarker>>
+  markSpecksInAllFrames(const SpeckCleanupParams &params);
+  QMap<int, QList<QcMarker>>
+  markSpecksInCurrentFrame(const SpeckCleanupParams &params);
+  QMap<int, QImage> absorbSpecksInAllFrames(const SpeckCleanupParams &params);
+  QMap<int, QImage> absorbSpecksInCurrentFrame(const SpeckCleanupParams &params);
+
+  // Bucket fill of the region under params.seed in frames first to last,
+  // one frame per worker. Returns the previous pixels of the filled area of
+  // every frame that changed.
+  QMap<int, FramePatch> fillFrames(int first, int last,
+                                   const FillParams &params);
+
+  // Colour propagation: the regions between line art in the key frame carry
+  // their colour to the matching regions of each following frame, matched
+  // pair by pair of neighbouring frames. Regions with no confident match are
+  // marked for review instead. Returns the previous pixels of the frames it
+  // changed; previousMarkers receives the previous marker lists.
+  QMap<int, QImage>
+  propagateColors(const PropagationParams &params,
+                  QMap<int, QList<QcMarker>> *previousMarkers = nullptr);
+  // Pastes patch over a frame and returns the pixels it covered, so the same
+  // call undoes and redoes a patch
+  FramePatch applyPatch(int index, const FramePatch &patch);
+
+  // Frame I/O and per-image kernels. They touch no sequence state, so the
+  // headless CLI uses them directly and they are safe on worker threads.
+  static QStringList imageNameFilters();
+  static QImage readFrameFile(const QString &path);
+  static bool writeFrameFile(const QImage &image, const QString &path,
+                             const QString &format);
+  // Build the kernel once per apply; it is read-only, so one kernel can be
+  // shared by every worker
+  static bool replaceColorsInImage(QImage &img, const ColorSwapKernel &kernel);
+  static QList<QcMarker>
+  guideCheckMarkers(const QImage &img, const QList<GuideColorParams> &params);
+  static QList<QcMarker> alphaCheckMarkers(const QImage &img,
+                                           const AlphaCheckParams &params);
+  static QList<QcMarker> speckMarkers(const QImage &img,
+                                      const SpeckCleanupParams &params);
+  // Fills each speck with the colour bordering it most; ties go to the colour
+  // met first scanning the speck in raster order
+  static bool absorbSpecks(QImage &img, const SpeckCleanupParams &params);
+  // Burns markers into the pixels, for output without an overlay
+  static void paintMarkers(QImage &img, const QList<QcMarker> &markers);
 
 signals:
   void sequenceLoaded();
+  void loadingChanged();
+  void loadProgress(int decoded, int total);
+  void loadCanceled();
+  void saveProgress(int written, int total);
+  void saveFinished(int written, const QStringList &failedPaths);
+  // Live reload: source files changed on disk are re-decoded in place
+  void framesReloaded(const QList<int> &indices);
+  void reloadConflict(int index, const QString &path);
   void currentIndexChanged(int index);
   void countChanged();
+  // Every frame was dropped for a new load
+  void framesCleared();
+  // Frames first..last are about to be appended by a progressive load, and
+  // have been once framesAppended() follows
+  void framesAboutToBeAppended(int first, int last);
+  void framesAppended();
   void currentImageChanged(const QImage &image);
   void imageModified(int index, const QImage &image);
+  void markersChanged(int index);
 
 private:
+  // Regions a check found in a frame, so the next run of the same check only
+  // relabels where the pixels changed since. Frames keep no pixels here,
+  // only the cache key of their current image and the bounds of the edits
+  // made since; storeFrameImage() keeps both up to date.
+  struct RegionCache {
+    size_t key = 0; // The check and its parameters; 0 if nothing is cached
+    // Pixels the regions were found in, only while a check runs, so the
+    // next frame can relabel from them
+    QImage image;
+    qint64 imageKey = 0;
+    QRect edited;
+    QVector<Region> regions;
+  };
+
   struct Frame {
     QString originalPath;
+    QImage image; // Null for lazy frames that have not been edited
+    QSize size;
+    bool dirty = false; // Edited since loaded or last saved
+    size_t sourceHash = 0; // Hash of the source file bytes; 0 if unknown
+    bool reloadConflict = false; // Source changed while the frame had edits
+    // Colours used by the current pixels; invalid until first decoded for
+    // lazy frames and after undo/redo, rebuilt by the next batch operation
+    ColorPresence colors;
+    QList<QcMarker> markers;
+    // Only kept for frames held in memory; lazy frames would stay pinned
+    RegionCache guideRegions;
+    RegionCache alphaRegions;
+  };
+
+  struct LoadedFrame {
     QImage image;
+    QSize size;
+    size_t sourceHash = 0;
+    bool fromCache = false;
+    ColorPresence colors;
   };
 
   QList<Frame> m_frames;
   int m_currentIndex = -1;
 
-  bool replaceColorsInImage(QImage &img, const QList<ColorSwap> &swaps);
+  // Storage modes of the loaded sequence and for the next load
+  bool m_indexedFrames = false;
+  bool m_indexedStorage = false;
+
+  // Sidecar cache; kept open after loading only for lazy frames
+  bool m_sequenceCacheEnabled = false;
+  QSharedPointer<SequenceCache> m_sequenceCache;
+  QFuture<void> m_sequenceCacheWrite;
+  int m_sequenceCacheMisses = 0;
+
+  void writeSequenceCache();
+
+  // Lazy residency
+  bool m_lazyFrames = false;
+  qint64 m_frameCacheBudget = 0;
+  mutable QCache<int, QImage> m_frameCache;
+  mutable QMutex m_frameCacheMutex;
+
+  QImage frameImage(int index) const;
+  void storeFrameImage(int index, const QImage &image,
+                       const ColorPresence &colors = ColorPresence());
+
+  // Async loading state
+  QFutureWatcher<LoadedFrame> *m_loadWatcher = nullptr;
+  QStringList m_loadPaths;
+  int m_nextLoadIndex = 0;
+
+  void commitDecodedFrames();
+  void onLoadFinished();
+  void abortLoading();
+
+  // Async export state
+  struct SaveJob {
+    int index = -1;
+    QImage image; // Null for lazy frames; decoded from sourcePath instead
+    qint64 imageKey = 0;
+    QString sourcePath;
+    QString targetPath;
+    QString format;
+    bool ok = false;
+    bool overwroteSource = false;
+    size_t writtenHash = 0;
+  };
+
+  QFutureWatcher<SaveJob> *m_saveWatcher = nullptr;
+
+  void onSaveFinished();
+  void finishSave();
+  void waitForSave();
+
+  // Live reload state
+  struct ReloadJob {
+    int index = -1;
+    QString path;
+    size_t previousHash = 0;
+    size_t hash = 0;
+    QImage image; // Only set when the content changed
+    ColorPresence colors;
+  };
+
+  QFileSystemWatcher *m_fileWatcher;
+  QTimer *m_reloadTimer;
+  QSet<QString> m_pendingReloads;
+  QFutureWatcher<ReloadJob> *m_reloadWatcher = nullptr;
+
+  void watchSourceFiles();
+  void onSourceFileChanged(const QString &path);
+  void reloadChangedFrames();
+  void onReloadFinished();
+  void abortReload();
+
+  // mayAffect, if set, lets frames whose colour index rules out any change
+  // be skipped without decoding them
+  QMap<int, QImage> applyToAllFrames(
+      const std::function<bool(QImage &)> &kernel,
+      const std::function<bool(const ColorPresence &)> &mayAffect = nullptr);
+  // Replaces the markers of one kind with those detect finds, on every frame
+  // or only the current one. With cache set, detect gets the regions of the
+  // same check (matching key) to start from, or null, and stores the regions
+  // it found in updated.
+  using MarkerDetect = std::function<QList<QcMarker>(
+      const QImage &, const RegionCache *previous, RegionCache *updated)>;
+  QMap<int, QList<QcMarker>> applyMarkerCheck(
+      QcMarker::Kind kind, bool allFrames, RegionCache Frame::*cache,
+      size_t key, const MarkerDetect &detect,
+      const std::function<bool(const ColorPresence &)> &mayAffect = nullptr);
+
+  // Replaces the markers of one kind on a frame, recording its previous list
+  // in previous when that changes it
+  void replaceMarkers(int index, QcMarker::Kind kind,
+                      const QList<QcMarker> &found,
+                      QMap<int, QList<QcMarker>> &previous);
+
+  // Check regions under the class keys classify gives, relabelling only the
+  // changed part of previous when it is usable
+  static QVector<Region> checkRegions(const QImage &img, size_t key,
+                                      const std::function<uchar(QRgb)> &classify,
+                                      const RegionCache *previous);
+  static size_t guideRegionsKey(const QList<GuideColorParams> &params);
+  static QList<QcMarker> guideMarkers(const QImage &img,
+                                      const QList<GuideColorParams> &params,
+                                      const RegionCache *previous,
+                                      RegionCache *updated);
+  static QList<QcMarker> alphaMarkers(const QImage &img,
+                                      const AlphaCheckParams &params,
+                                      const RegionCache *previous,
+                                      RegionCache *updated);
 };
 
 #endif // IMAGESEQUENCE_H
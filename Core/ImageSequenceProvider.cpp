@@ -1,16 +1,19 @@
 #include "ImageSequenceProvider.h"
 #include "ImageSequence.h"
+#include "SwapPreview.h"
 #include <QUrlQuery>
 
-ImageSequenceProvider::ImageSequenceProvider(ImageSequence *sequence)
-    : QQuickImageProvider(QQuickImageProvider::Image), m_sequence(sequence) {}
+ImageSequenceProvider::ImageSequenceProvider(ImageSequence *sequence,
+                                             SwapPreview *preview)
+    : QQuickImageProvider(QQuickImageProvider::Image), m_sequence(sequence),
+      m_preview(preview) {}
 
 QImage ImageSequenceProvider::requestImage(const QString &id, QSize *size,
                                            const QSize &requestedSize) {
   QImage img;
 
-  // Parse id - format: "current" or index number, with optional query params
-  // Examples: "current?r=1", "0?thumbnail=true&r=2"
+  // Parse id - format: "current", "preview" or index number, with optional
+  // query params. Examples: "current?r=1", "0?thumbnail=true&r=2"
   QString cleanId = id;
   bool isThumbnail = false;
 
@@ -25,6 +28,17 @@ QImage ImageSequenceProvider::requestImage(const QString &id, QSize *size,
 
   if (cleanId == "current") {
     img = m_sequence->currentImage();
+  } else if (cleanId == "preview") {
+    // Swap preview of the current frame. The proxy is scaled back up to the
+    // frame size so canvas coordinates stay the same.
+    img = m_sequence->currentImage();
+    QImage preview = m_preview ? m_preview->previewImage() : QImage();
+    if (!preview.isNull() && !img.isNull()) {
+      img = preview.size() == img.size()
+                ? preview
+                : preview.scaled(img.size(), Qt::IgnoreAspectRatio,
+                                 Qt::FastTransformation);
+    }
   } else {
     bool ok;
     int index = cleanId.toInt(&ok);
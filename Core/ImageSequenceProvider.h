@@ -4,16 +4,19 @@
 #include <QQuickImageProvider>
 
 class ImageSequence;
+class SwapPreview;
 
 class ImageSequenceProvider : public QQuickImageProvider {
 public:
-  explicit ImageSequenceProvider(ImageSequence *sequence);
+  explicit ImageSequenceProvider(ImageSequence *sequence,
+                                 SwapPreview *preview = nullptr);
 
   QImage requestImage(const QString &id, QSize *size,
                       const QSize &requestedSize) override;
 
 private:
   ImageSequence *m_sequence;
+  SwapPreview *m_preview;
 };
 
 #endif // IMAGESEQUENCEPROVIDER_H
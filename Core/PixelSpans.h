@@ -0,0 +1,80 @@
+#ifndef PIXELSPANS_H
+#define PIXELSPANS_H
+
+#include <QtGui/QRgb>
+
+// Runs of identical pixels along a scanline. Cel frames are mostly long flat
+// runs, so kernels evaluate their test once per run and fill the result
+// instead of testing every pixel.
+struct PixelSpan {
+  int x = 0;
+  int length = 0;
+  QRgb color = 0;
+};
+
+// Walks one scanline as maximal runs of identical pixels:
+//
+//   SpanIterator spans(line, width);
+//   PixelSpan span;
+//   while (spans.next(&span)) { ... }
+class SpanIterator {
+public:
+  SpanIterator(const QRgb *line, int width) : m_line(line), m_width(width) {}
+
+  bool next(PixelSpan *span) {
+    if (m_x >= m_width)
+      return false;
+
+    const QRgb color = m_line[m_x];
+    int end = m_x + 1;
+    while (end < m_width && m_line[end] == color)
+      ++end;
+
+    span->x = m_x;
+    span->length = end - m_x;
+    span->color = color;
+    m_x = end;
+    return true;
+  }
+
+private:
+  const QRgb *m_line;
+  int m_width;
+  int m_x = 0;
+};
+
+// Same for 8-bit palette indices
+struct IndexSpan {
+  int x = 0;
+  int length = 0;
+  uchar index = 0;
+};
+
+class IndexSpanIterator {
+public:
+  IndexSpanIterator(const uchar *line, int width)
+      : m_line(line), m_width(width) {}
+
+  bool next(IndexSpan *span) {
+    if (m_x >= m_width)
+      return false;
+
+    const uchar index = m_line[m_x];
+    int end = m_x + 1;
+    while (end < m_width && m_line[end] == index)
+      ++end;
+
+    span->x = m_x;
+    span->length = end - m_x;
+    span->index = index;
+    m_x = end;
+    return true;
+  }
+
+private:
+  const uchar *m_line;
+  int m_width;
+  int m_x = 0;
+};
+
+#endif // PIXELSPANS_H
@@ -0,0 +1,314 @@
+#include "RegionLabeler.h"
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Planes this large are labelled in bands of rows on the thread pool
+const qint64 ParallelPixels = 4096 * 2048;
+const int BandRows = 256;
+
+} // namespace
+
+QPointF Region::centroid() const {
+  if (area == 0)
+    return QPointF();
+  return QPointF(double(sumX) / area, double(sumY) / area);
+}
+
+QPoint Region::center() const {
+  if (area == 0)
+    return QPoint();
+  return QPoint(int(sumX / area), int(sumY / area));
+}
+
+const QVector<Region> &RegionLabeler::label(const uchar *keys, int width,
+                                            int height,
+                                            qsizetype bytesPerLine) {
+  if (bytesPerLine < 0)
+    bytesPerLine = width;
+  return labelPlane<uchar>(keys, width, height, bytesPerLine, true);
+}
+
+const QVector<Region> &RegionLabeler::labelColors(const QImage &image) {
+  if (image.format() == QImage::Format_Indexed8) {
+    labelPlane<uchar>(image.constBits(), image.width(), image.height(),
+                      image.bytesPerLine(), false);
+    const QVector<QRgb> table = image.colorTable();
+    for (Region &region : m_regions)
+      region.key = region.key < quint32(table.size()) ? table[region.key] : 0;
+    return m_regions;
+  }
+
+  const QImage argb = image.format() == QImage::Format_ARGB32
+                          ? image
+                          : image.convertToFormat(QImage::Format_ARGB32);
+  return labelPlane<QRgb>(argb.constBits(), argb.width(), argb.height(),
+                          argb.bytesPerLine(), false);
+}
+
+// With background set, key 0 belongs to no region
+template <typename Key>
+const QVector<Region> &
+RegionLabeler::labelPlane(const uchar *plane, int width, int height,
+                          qsizetype bytesPerLine, bool background) {
+  m_width = width;
+  m_height = height;
+  m_regions.clear();
+
+  // Pass 1: runs of each row, united with overlapping runs of the row above
+  const int bandRows = m_bandRows > 0 ? m_bandRows : BandRows;
+  const int bandCount =
+      m_bandRows > 0 || qint64(width) * height >= ParallelPixels
+          ? qMax(1, (height + bandRows - 1) / bandRows)
+          : 1;
+  m_bands.resize(bandCount);
+  for (int i = 0; i < bandCount; ++i) {
+    m_bands[i].top = i * bandRows;
+    m_bands[i].bottom =
+        bandCount == 1 ? height : qMin(height, (i + 1) * bandRows);
+  }
+  if (bandCount == 1) {
+    collectRuns<Key>(plane, width, bytesPerLine, background, &m_bands[0]);
+  } else {
+    QtConcurrent::blockingMap(m_bands, [&](Band &band) {
+      collectRuns<Key>(plane, width, bytesPerLine, background, &band);
+    });
+  }
+
+  // Concatenate in band order, which keeps the runs in raster order
+  m_runs.clear();
+  m_parent.clear();
+  for (int i = 0; i < bandCount; ++i) {
+    Band &band = m_bands[i];
+    const int offset = m_runs.size();
+    m_runs.append(band.runs);
+    for (int parent : band.parent)
+      m_parent.append(parent + offset);
+
+    // The band's first row against the previous band's last row
+    if (i > 0) {
+      const Band &above = m_bands[i - 1];
+      const int aboveStart = offset - above.runs.size();
+      uniteRows(m_runs, m_parent, aboveStart + above.lastRowStart, offset,
+                offset + band.firstRowEnd);
+    }
+  }
+
+  // Pass 2: a root is always the first run of its region
+  m_regionOfRun.resize(m_runs.size());
+  for (int i = 0; i < m_runs.size(); ++i) {
+    const Run &run = m_runs[i];
+    const int root = findRoot(m_parent, i);
+    if (root == i) {
+      Region region;
+      region.key = run.key;
+      region.firstPixel = QPoint(run.x0, run.y);
+      region.bounds = QRect(run.x0, run.y, run.x1 - run.x0, 1);
+      m_regionOfRun[i] = m_regions.size();
+      m_regions.append(region);
+    } else {
+      m_regionOfRun[i] = m_regionOfRun[root];
+    }
+
+    Region &region = m_regions[m_regionOfRun[i]];
+    const qint64 length = run.x1 - run.x0;
+    region.area += length;
+    region.sumX += (qint64(run.x0) + run.x1 - 1) * length / 2;
+    region.sumY += qint64(run.y) * length;
+    region.bounds |= QRect(run.x0, run.y, run.x1 - run.x0, 1);
+  }
+
+  return m_regions;
+}
+
+QVector<Region> RegionLabeler::relabel(
+    const QVector<Region> &previous, const QSize &size, const QRect &dirty,
+    const std::function<QVector<uchar>(const QRect &)> &keysOf) {
+  const QRect plane(QPoint(0, 0), size);
+  if (dirty.isEmpty())
+    return previous;
+
+  // A region touches the window once each of its four sides is in reach of
+  // the window's opposite side. The window only grows, so a cursor per side
+  // over the regions sorted by that side finds each side as it comes into
+  // reach, and no growth step rescans every region.
+  QRect window = dirty.adjusted(-1, -1, 1, 1) & plane;
+  const int count = previous.size();
+  QVector<int> byTop(count);
+  std::iota(byTop.begin(), byTop.end(), 0);
+  QVector<int> byBottom = byTop, byLeft = byTop, byRight = byTop;
+  auto sortBy = [&](QVector<int> &order, auto less) {
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return less(previous[a].bounds, previous[b].bounds);
+    });
+  };
+  sortBy(byTop,
+         [](const QRect &a, const QRect &b) { return a.top() < b.top(); });
+  sortBy(byBottom, [](const QRect &a, const QRect &b) {
+    return a.bottom() > b.bottom();
+  });
+  sortBy(byLeft,
+         [](const QRect &a, const QRect &b) { return a.left() < b.left(); });
+  sortBy(byRight,
+         [](const QRect &a, const QRect &b) { return a.right() > b.right(); });
+
+  QVector<uchar> sidesInReach(count, 0);
+  QVector<bool> inWindow(count, false);
+  bool grown = true;
+  auto advance = [&](const QVector<int> &order, int &cursor, auto inReach) {
+    for (; cursor < count && inReach(previous[order[cursor]].bounds);
+         ++cursor) {
+      const int i = order[cursor];
+      if (++sidesInReach[i] < 4)
+        continue;
+      inWindow[i] = true;
+      if (!window.contains(previous[i].bounds)) {
+        window |= previous[i].bounds;
+        grown = true;
+      }
+    }
+  };
+  int top = 0, bottom = 0, left = 0, right = 0;
+  while (grown && window != plane) {
+    grown = false;
+    advance(byTop, top,
+            [&](const QRect &b) { return b.top() <= window.bottom(); });
+    advance(byBottom, bottom,
+            [&](const QRect &b) { return b.bottom() >= window.top(); });
+    advance(byLeft, left,
+            [&](const QRect &b) { return b.left() <= window.right(); });
+    advance(byRight, right,
+            [&](const QRect &b) { return b.right() >= window.left(); });
+  }
+
+  if (window == plane) {
+    const QVector<uchar> keys = keysOf(plane);
+    return label(keys.constData(), size.width(), size.height());
+  }
+
+  QVector<Region> result;
+  for (int i = 0; i < previous.size(); ++i) {
+    if (!inWindow[i])
+      result.append(previous[i]);
+  }
+
+  const QVector<uchar> keys = keysOf(window);
+  const QPoint offset = window.topLeft();
+  for (Region region : label(keys.constData(), window.width(),
+                             window.height())) {
+    region.sumX += qint64(offset.x()) * region.area;
+    region.sumY += qint64(offset.y()) * region.area;
+    region.bounds.translate(offset);
+    region.firstPixel += offset;
+    result.append(region);
+  }
+
+  // Back to raster order of first pixels, as label() returns them
+  std::sort(result.begin(), result.end(), [](const Region &a, const Region &b) {
+    return a.firstPixel.y() != b.firstPixel.y()
+               ? a.firstPixel.y() < b.firstPixel.y()
+               : a.firstPixel.x() < b.firstPixel.x();
+  });
+  return result;
+}
+
+const QVector<Region> &RegionLabeler::regions() const { return m_regions; }
+
+void RegionLabeler::setBandRows(int rows) { m_bandRows = qMax(0, rows); }
+
+QVector<int> RegionLabeler::labelMap() const {
+  QVector<int> map(qsizetype(m_width) * m_height, -1);
+  for (int i = 0; i < m_runs.size(); ++i) {
+    const Run &run = m_runs[i];
+    int *row = map.data() + qsizetype(run.y) * m_width;
+    std::fill(row + run.x0, row + run.x1, m_regionOfRun[i]);
+  }
+  return map;
+}
+
+QVector<RegionLabeler::RegionRun> RegionLabeler::regionRuns() const {
+  QVector<RegionRun> runs(m_runs.size());
+  for (int i = 0; i < m_runs.size(); ++i) {
+    const Run &run = m_runs[i];
+    runs[i] = RegionRun{run.y, run.x0, run.x1, m_regionOfRun[i]};
+  }
+  return runs;
+}
+
+template <typename Key>
+void RegionLabeler::collectRuns(const uchar *plane, int width,
+                                qsizetype bytesPerLine, bool background,
+                                Band *band) {
+  band->runs.clear();
+  band->parent.clear();
+  band->firstRowEnd = 0;
+  band->lastRowStart = 0;
+
+  int previousStart = 0;
+  for (int y = band->top; y < band->bottom; ++y) {
+    const Key *row =
+        reinterpret_cast<const Key *>(plane + qsizetype(y) * bytesPerLine);
+    const int rowStart = band->runs.size();
+
+    int x = 0;
+    while (x < width) {
+      const Key key = row[x];
+      int end = x + 1;
+      while (end < width && row[end] == key)
+        ++end;
+      if (key != 0 || !background) {
+        band->runs.append({y, x, end, key});
+        band->parent.append(band->runs.size() - 1);
+      }
+      x = end;
+    }
+
+    if (y == band->top)
+      band->firstRowEnd = band->runs.size();
+    else
+      uniteRows(band->runs, band->parent, previousStart, rowStart,
+                band->runs.size());
+    band->lastRowStart = rowStart;
+    previousStart = rowStart;
+  }
+}
+
+// Unites the runs [rowStart, rowEnd) with the touching runs of the row above,
+// which are [previousStart, rowStart)
+void RegionLabeler::uniteRows(const QVector<Run> &runs, QVector<int> &parent,
+                              int previousStart, int rowStart, int rowEnd) {
+  // Both rows are sorted by x and their runs do not overlap, so one sweep
+  // finds every touching pair
+  int p = previousStart;
+  for (int c = rowStart; c < rowEnd; ++c) {
+    const Run &run = runs[c];
+    while (p < rowStart && runs[p].x1 <= run.x0)
+      ++p;
+    for (int q = p; q < rowStart && runs[q].x0 < run.x1; ++q) {
+      if (runs[q].key == run.key)
+        unite(parent, q, c);
+    }
+  }
+}
+
+int RegionLabeler::findRoot(QVector<int> &parent, int run) {
+  while (parent[run] != run) {
+    parent[run] = parent[parent[run]]; // Path halving
+    run = parent[run];
+  }
+  return run;
+}
+
+void RegionLabeler::unite(QVector<int> &parent, int a, int b) {
+  a = findRoot(parent, a);
+  b = findRoot(parent, b);
+  if (a == b)
+    return;
+  // The earlier run stays the root
+  if (a < b)
+    parent[b] = a;
+  else
+    parent[a] = b;
+}
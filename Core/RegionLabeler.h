@@ -0,0 +1,122 @@
+#ifndef REGIONLABELER_H
+#define REGIONLABELER_H
+
+#include <QImage>
+#include <QPoint>
+#include <QPointF>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include <functional>
+
+// One 4-connected region of equal key
+struct Region {
+  quint32 key = 0; // Class value, or colour for labelColors()
+  qint64 area = 0;
+  qint64 sumX = 0; // Sum of pixel coordinates, for the centre of mass
+  qint64 sumY = 0;
+  QRect bounds;
+  QPoint firstPixel; // First pixel in raster order
+
+  QPointF centroid() const;
+  // Centre of mass truncated to a pixel, as the checks draw it
+  QPoint center() const;
+};
+
+// Connected-component labelling on a key plane: one byte per pixel, 0 for
+// background and any other value for a class. Neighbouring pixels of the same
+// class belong to the same region.
+//
+// Works on horizontal runs rather than pixels. The first pass collects the
+// runs of every row and unions each with the overlapping runs of the row
+// above; the second resolves the union-find roots and accumulates the
+// statistics. Every union keeps the earlier run as the root, so regions come
+// out in raster order of their first pixel, the order a scan-and-flood finds
+// them in. Buffers are kept between calls; reuse one labeler per thread.
+//
+// Large planes are cut into bands of rows whose runs are collected and
+// united concurrently. The bands' runs are concatenated in order and the
+// runs on each seam united afterwards; since roots are still the earliest
+// run, the regions are exactly those of a sequential pass.
+class RegionLabeler {
+public:
+  // A horizontal run of one region's pixels
+  struct RegionRun {
+    int y;
+    int x0;
+    int x1; // Exclusive
+    int region;
+  };
+
+  const QVector<Region> &label(const uchar *keys, int width, int height,
+                               qsizetype bytesPerLine = -1);
+  // Regions of identical colour over every pixel; there is no background.
+  // Indexed8 images are labelled on their palette indices.
+  const QVector<Region> &labelColors(const QImage &image);
+
+  // Regions of a plane of the given size that differs from the plane
+  // previous was labelled on only inside dirty. keysOf returns the row-major
+  // key plane of a rectangle of the new plane.
+  //
+  // The window to relabel starts as dirty grown by a pixel and absorbs the
+  // bounds of every previous region it touches until none is left straddling
+  // it. No region can then cross the window's edge, so regions outside are
+  // kept as they were and only the window is labelled. The result equals a
+  // full label() of the new plane; the window grows to the whole plane when
+  // the change touches a region that spans it.
+  QVector<Region>
+  relabel(const QVector<Region> &previous, const QSize &size,
+          const QRect &dirty,
+          const std::function<QVector<uchar>(const QRect &)> &keysOf);
+
+  const QVector<Region> &regions() const;
+
+  // Cuts planes of any size into bands of this many rows; 0 restores the
+  // default of bands only for large planes. For testing the seams.
+  void setBandRows(int rows);
+
+  // Region index of every pixel of the plane last passed to label() or
+  // labelColors(), -1 for background
+  QVector<int> labelMap() const;
+  // The same as runs in raster order, a fraction of the size for line art
+  QVector<RegionRun> regionRuns() const;
+
+private:
+  struct Run {
+    int y;
+    int x0;
+    int x1; // Exclusive
+    quint32 key;
+  };
+
+  struct Band {
+    int top = 0;
+    int bottom = 0; // Exclusive
+    QVector<Run> runs;
+    QVector<int> parent; // Band-local indices
+    int firstRowEnd = 0;  // Runs of the band's first row end here
+    int lastRowStart = 0; // Runs of its last row start here
+  };
+
+  int m_width = 0;
+  int m_height = 0;
+  int m_bandRows = 0;
+  QVector<Run> m_runs;
+  QVector<int> m_parent;
+  QVector<int> m_regionOfRun;
+  QVector<Region> m_regions;
+  QVector<Band> m_bands;
+
+  template <typename Key>
+  const QVector<Region> &labelPlane(const uchar *plane, int width, int height,
+                                    qsizetype bytesPerLine, bool background);
+  template <typename Key>
+  static void collectRuns(const uchar *plane, int width,
+                          qsizetype bytesPerLine, bool background, Band *band);
+  static void uniteRows(const QVector<Run> &runs, QVector<int> &parent,
+                        int previousStart, int rowStart, int rowEnd);
+  static int findRoot(QVector<int> &parent, int run);
+  static void unite(QVector<int> &parent, int a, int b);
+};
+
+#endif // REGIONLABELER_H
@@ -0,0 +1,102 @@
+#include "RegionMatcher.h"
+#include <QHash>
+#include <cmath>
+
+namespace {
+
+double aspect(const Region &region) {
+  return double(region.bounds.width()) / region.bounds.height();
+}
+
+double extent(const Region &region) {
+  return double(region.area) /
+         (qint64(region.bounds.width()) * region.bounds.height());
+}
+
+// The centroid term alone, which rules most pairs out before any logarithm
+double distanceCost(const Region &a, const Region &b) {
+  const QPointF d = a.centroid() - b.centroid();
+  return std::sqrt(d.x() * d.x() + d.y() * d.y()) /
+         std::sqrt(double(qMax(a.area, b.area)));
+}
+
+} // namespace
+
+double RegionMatcher::cost(const Region &a, const Region &b) {
+  if (a.area == 0 || b.area == 0)
+    return HUGE_VAL;
+  return distanceCost(a, b) + std::abs(std::log(double(a.area) / b.area)) +
+         0.5 * std::abs(std::log(aspect(a) / aspect(b))) +
+         0.5 * std::abs(extent(a) - extent(b));
+}
+
+QVector<RegionMatcher::Candidate>
+RegionMatcher::match(const QVector<Region> &previous,
+                     const QVector<Region> &current, int minArea,
+                     double maxCost) {
+  QVector<Candidate> candidates(current.size());
+  for (int i = 0; i < current.size(); ++i) {
+    const Region &region = current[i];
+    if (region.area < minArea)
+      continue;
+
+    Candidate &candidate = candidates[i];
+    for (int j = 0; j < previous.size(); ++j) {
+      const Region &other = previous[j];
+      if (other.area < minArea || distanceCost(region, other) > maxCost)
+        continue;
+
+      const double c = cost(region, other);
+      if (c > maxCost)
+        continue;
+      if (candidate.best < 0 || c < candidate.bestCost) {
+        candidate.runnerUp = candidate.best;
+        candidate.runnerUpCost = candidate.bestCost;
+        candidate.best = j;
+        candidate.bestCost = c;
+      } else if (candidate.runnerUp < 0 || c < candidate.runnerUpCost) {
+        candidate.runnerUp = j;
+        candidate.runnerUpCost = c;
+      }
+    }
+  }
+  return candidates;
+}
+
+QVector<QRgb> RegionMatcher::dominantColors(const QImage &img,
+                                            const QVector<int> &labels,
+                                            int regionCount) {
+  QVector<QHash<QRgb, qint64>> counts(regionCount);
+  const QImage argb = img.format() == QImage::Format_ARGB32
+                          ? img
+                          : img.convertToFormat(QImage::Format_ARGB32);
+  const int w = argb.width();
+
+  // Painted regions are mostly flat, so pixels are counted a run at a time
+  for (int y = 0; y < argb.height(); ++y) {
+    const QRgb *row = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+    const int *label = labels.constData() + qsizetype(y) * w;
+    int x = 0;
+    while (x < w) {
+      int end = x + 1;
+      while (end < w && label[end] == label[x] && row[end] == row[x])
+        ++end;
+      if (label[x] >= 0 && label[x] < regionCount)
+        counts[label[x]][row[x]] += end - x;
+      x = end;
+    }
+  }
+
+  QVector<QRgb> colors(regionCount, 0);
+  for (int i = 0; i < regionCount; ++i) {
+    qint64 most = 0;
+    for (auto it = counts[i].constBegin(); it != counts[i].constEnd(); ++it) {
+      // Ties go to the lower colour, so the result does not depend on hashing
+      if (it.value() > most || (it.value() == most && it.key() < colors[i])) {
+        most = it.value();
+        colors[i] = it.key();
+      }
+    }
+  }
+  return colors;
+}
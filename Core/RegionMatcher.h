@@ -0,0 +1,39 @@
+#ifndef REGIONMATCHER_H
+#define REGIONMATCHER_H
+
+#include "RegionLabeler.h"
+#include <QImage>
+#include <QVector>
+
+// Pairs the closed regions of one drawing with those of the next by where
+// they are, how big they are and their shape, so colours painted in one
+// frame can be carried to the following ones.
+//
+// The cost of a pair is the distance between the centroids relative to the
+// size of the larger region, plus the log of the area ratio, plus half the
+// log ratio of the bounding-box aspects and half the difference of the
+// extents (area over bounding-box area). Identical regions cost 0.
+class RegionMatcher {
+public:
+  struct Candidate {
+    int best = -1; // Region of the previous frame; -1 if none is close enough
+    double bestCost = 0;
+    int runnerUp = -1; // Next best region; -1 if none is close enough
+    double runnerUpCost = 0;
+  };
+
+  // The two cheapest regions of previous within maxCost for every region of
+  // current. Regions smaller than minArea are neither matched nor candidates.
+  static QVector<Candidate> match(const QVector<Region> &previous,
+                                  const QVector<Region> &current, int minArea,
+                                  double maxCost);
+  static double cost(const Region &a, const Region &b);
+
+  // Most common colour of each region, given the region index of every pixel
+  // as RegionLabeler::labelMap() returns it
+  static QVector<QRgb> dominantColors(const QImage &img,
+                                      const QVector<int> &labels,
+                                      int regionCount);
+};
+
+#endif // REGIONMATCHER_H
@@ -0,0 +1,150 @@
+#include "SequenceCache.h"
+#include "TgaCodec.h"
+#include <QByteArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const char FileMagic[8] = {'C', 'P', 'C', 'A', 'C', 'H', 'E', '1'};
+const char IndexMagic[8] = {'C', 'P', 'I', 'N', 'D', 'E', 'X', '1'};
+const qint64 FooterSize = 16; // Index offset + magic
+
+qint64 modifiedTime(const QFileInfo &info) {
+  return info.lastModified().toMSecsSinceEpoch();
+}
+
+} // namespace
+
+QString SequenceCache::cachePathFor(const QString &framePath) {
+  return QFileInfo(framePath).dir().filePath(".celpaint-cache");
+}
+
+bool SequenceCache::open(const QString &cachePath) {
+  m_file.setFileName(cachePath);
+  if (!m_file.open(QIODevice::ReadOnly))
+    return false;
+
+  m_size = m_file.size();
+  if (m_size < qint64(sizeof(FileMagic)) + FooterSize)
+    return false;
+
+  m_data = m_file.map(0, m_size);
+  if (!m_data)
+    return false;
+
+  const uchar *footer = m_data + m_size - FooterSize;
+  if (std::memcmp(m_data, FileMagic, sizeof(FileMagic)) != 0 ||
+      std::memcmp(footer + 8, IndexMagic, sizeof(IndexMagic)) != 0)
+    return false;
+
+  const qint64 indexOffset = qFromLittleEndian<qint64>(footer);
+  if (indexOffset < qint64(sizeof(FileMagic)) ||
+      indexOffset > m_size - FooterSize)
+    return false;
+
+  QByteArray index = QByteArray::fromRawData(
+      reinterpret_cast<const char *>(m_data + indexOffset),
+      m_size - FooterSize - indexOffset);
+  QDataStream in(index);
+  in.setVersion(QDataStream::Qt_6_0);
+
+  quint32 count = 0;
+  in >> count;
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+    Entry entry;
+    in >> entry.relativePath >> entry.sourceSize >> entry.sourceModified >>
+        entry.offset >> entry.length;
+
+    if (entry.offset < qint64(sizeof(FileMagic)) || entry.length <= 0 ||
+        entry.offset + entry.length > indexOffset)
+      continue;
+    m_lookup.insert(entry.relativePath, m_entries.size());
+    m_entries.append(entry);
+  }
+
+  m_dirPath = QFileInfo(cachePath).absolutePath();
+  return in.status() == QDataStream::Ok;
+}
+
+bool SequenceCache::isOpen() const { return m_data != nullptr; }
+
+QImage SequenceCache::read(const QString &framePath) const {
+  if (!m_data)
+    return QImage();
+
+  auto it = m_lookup.constFind(QDir(m_dirPath).relativeFilePath(framePath));
+  if (it == m_lookup.constEnd())
+    return QImage();
+  return readEntry(m_entries[*it]);
+}
+
+int SequenceCache::count() const { return m_entries.size(); }
+
+QString SequenceCache::sourcePathAt(int frameNumber) const {
+  if (frameNumber < 0 || frameNumber >= m_entries.size())
+    return QString();
+  return QDir(m_dirPath).filePath(m_entries[frameNumber].relativePath);
+}
+
+QImage SequenceCache::readAt(int frameNumber) const {
+  if (!m_data || frameNumber < 0 || frameNumber >= m_entries.size())
+    return QImage();
+  return readEntry(m_entries[frameNumber]);
+}
+
+QImage SequenceCache::readEntry(const Entry &entry) const {
+  QFileInfo source(QDir(m_dirPath).filePath(entry.relativePath));
+  if (source.size() != entry.sourceSize ||
+      modifiedTime(source) != entry.sourceModified)
+    return QImage();
+
+  return TgaCodec::read(m_data + entry.offset, entry.length);
+}
+
+bool SequenceCache::write(const QString &cachePath,
+                          const QList<QPair<QString, QImage>> &frames) {
+  QSaveFile file(cachePath);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+
+  if (file.write(FileMagic, sizeof(FileMagic)) != qint64(sizeof(FileMagic)))
+    return false;
+
+  QDir dir(QFileInfo(cachePath).absolutePath());
+  QByteArray index;
+  QDataStream out(&index, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << quint32(0); // Patched once the entry count is known
+
+  quint32 count = 0;
+  for (const auto &frame : frames) {
+    QFileInfo source(frame.first);
+    if (frame.second.isNull() || !source.exists())
+      continue;
+
+    const qint64 offset = file.pos();
+    if (!TgaCodec::write(frame.second, &file, true))
+      return false;
+
+    out << dir.relativeFilePath(frame.first) << source.size()
+        << modifiedTime(source) << offset << (file.pos() - offset);
+    ++count;
+  }
+  qToBigEndian<quint32>(count, index.data()); // QDataStream is big-endian
+
+  uchar footer[FooterSize];
+  qToLittleEndian<qint64>(file.pos(), footer);
+  std::memcpy(footer + 8, IndexMagic, sizeof(IndexMagic));
+
+  if (file.write(index) != index.size() ||
+      file.write(reinterpret_cast<const char *>(footer), FooterSize) !=
+          FooterSize)
+    return false;
+
+  return file.commit();
+}
@@ -0,0 +1,58 @@
+#ifndef SEQUENCECACHE_H
+#define SEQUENCECACHE_H
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Single-file sidecar holding already decoded frames next to a sequence, so
+// reopening a cut skips PNG/TGA decoding for unchanged sources.
+//
+// Layout: an 8-byte magic, one RLE TGA chunk per frame, then an index that
+// maps each source (relative to the cache directory) to its chunk together
+// with the source size and modification time. The file ends with the index
+// offset and a second magic. Chunks are read straight from a memory mapping,
+// so lookups are random access and safe from multiple threads.
+class SequenceCache {
+public:
+  static QString cachePathFor(const QString &framePath);
+
+  bool open(const QString &cachePath);
+  bool isOpen() const;
+
+  // Returns the cached pixels of a source file, or a null image if it is not
+  // cached or has changed on disk since it was cached
+  QImage read(const QString &framePath) const;
+
+  // Random access in the order the frames were written
+  int count() const;
+  QString sourcePathAt(int frameNumber) const;
+  QImage readAt(int frameNumber) const;
+
+  static bool write(const QString &cachePath,
+                    const QList<QPair<QString, QImage>> &frames);
+
+private:
+  struct Entry {
+    QString relativePath;
+    qint64 sourceSize = 0;
+    qint64 sourceModified = 0;
+    qint64 offset = 0;
+    qint64 length = 0;
+  };
+
+  QFile m_file;
+  const uchar *m_data = nullptr;
+  qint64 m_size = 0;
+  QString m_dirPath; // Absolute; a shared QDir is not safe across threads
+  QList<Entry> m_entries;
+  QHash<QString, int> m_lookup;
+
+  QImage readEntry(const Entry &entry) const;
+};
+
+#endif // SEQUENCECACHE_H
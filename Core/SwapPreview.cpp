@@ -0,0 +1,134 @@
+#include "SwapPreview.h"
+#include "ImageSequence.h"
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+const int ProxyExtent = 1024; // Longest side of the proxy
+const int DebounceMs = 120;
+
+} // namespace
+
+SwapPreview::SwapPreview(ImageSequence *sequence, QObject *parent)
+    : QObject(parent), m_sequence(sequence), m_debounce(new QTimer(this)) {
+  m_debounce->setSingleShot(true);
+  m_debounce->setInterval(DebounceMs);
+  connect(m_debounce, &QTimer::timeout, this, &SwapPreview::startRender);
+
+  // Frame switches and edits invalidate the preview; never show it over a
+  // different image while the new one renders
+  connect(m_sequence, &ImageSequence::currentImageChanged, this, [this]() {
+    setPreview(QImage());
+    schedule();
+  });
+}
+
+SwapPreview::~SwapPreview() {
+  if (m_watcher) {
+    m_watcher->disconnect(this);
+    m_watcher->waitForFinished();
+  }
+}
+
+void SwapPreview::setEnabled(bool enabled) {
+  if (m_enabled == enabled)
+    return;
+  m_enabled = enabled;
+  schedule();
+}
+
+bool SwapPreview::isEnabled() const { return m_enabled; }
+
+void SwapPreview::setSwaps(const QList<ColorSwap> &swaps) {
+  m_swaps = swaps;
+  if (m_enabled)
+    schedule();
+}
+
+QImage SwapPreview::previewImage() const {
+  QMutexLocker locker(&m_previewMutex);
+  return m_preview;
+}
+
+bool SwapPreview::hasPreview() const {
+  QMutexLocker locker(&m_previewMutex);
+  return !m_preview.isNull();
+}
+
+void SwapPreview::schedule() {
+  ++m_generation; // Anything in flight is now stale
+  if (!m_enabled) {
+    m_debounce->stop();
+    setPreview(QImage());
+    return;
+  }
+  m_debounce->start();
+}
+
+void SwapPreview::startRender() {
+  if (m_watcher) {
+    m_rerun = true;
+    return;
+  }
+
+  const QImage source = m_sequence->currentImage();
+  if (source.isNull()) {
+    setPreview(QImage());
+    return;
+  }
+
+  const quint64 generation = m_generation;
+  const qint64 sourceKey = source.cacheKey();
+  const QImage proxy = sourceKey == m_proxyKey ? m_proxy : QImage();
+  const QList<ColorSwap> swaps = m_swaps;
+
+  m_watcher = new QFutureWatcher<Render>(this);
+  connect(m_watcher, &QFutureWatcher<Render>::finished, this,
+          &SwapPreview::onRenderFinished);
+  m_watcher->setFuture(QtConcurrent::run([=]() {
+    Render render;
+    render.generation = generation;
+    render.sourceKey = sourceKey;
+    render.proxy = proxy;
+    if (render.proxy.isNull()) {
+      render.proxy =
+          qMax(source.width(), source.height()) > ProxyExtent
+              ? source.scaled(ProxyExtent, ProxyExtent, Qt::KeepAspectRatio,
+                              Qt::FastTransformation)
+              : source;
+    }
+
+    render.preview = render.proxy;
+    ImageSequence::replaceColorsInImage(render.preview,
+                                        ColorSwapKernel(swaps));
+    return render;
+  }));
+}
+
+void SwapPreview::onRenderFinished() {
+  const Render render = m_watcher->result();
+  m_watcher->deleteLater();
+  m_watcher = nullptr;
+
+  m_proxy = render.proxy;
+  m_proxyKey = render.sourceKey;
+
+  if (render.generation == m_generation && m_enabled)
+    setPreview(render.preview);
+
+  if (m_rerun) {
+    m_rerun = false;
+    startRender();
+  }
+}
+
+void SwapPreview::setPreview(const QImage &preview) {
+  {
+    QMutexLocker locker(&m_previewMutex);
+    if (preview.isNull() && m_preview.isNull())
+      return;
+    m_preview = preview;
+  }
+  emit previewChanged();
+}
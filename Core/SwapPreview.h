@@ -0,0 +1,70 @@
+#ifndef SWAPPREVIEW_H
+#define SWAPPREVIEW_H
+
+#include "CelPaintTypes.h"
+#include <QFutureWatcher>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+
+class ImageSequence;
+
+// Non-destructive preview of the colour swap table on the current frame.
+//
+// Edits are debounced, then the swaps run on a worker thread against a
+// reduced-resolution proxy of the frame (nearest-neighbour, so flat colours
+// stay exact). The proxy is reused until the frame changes. Every request
+// bumps a generation counter and results of stale generations are dropped;
+// at most one render runs at a time.
+class SwapPreview : public QObject {
+  Q_OBJECT
+
+public:
+  explicit SwapPreview(ImageSequence *sequence, QObject *parent = nullptr);
+  ~SwapPreview() override;
+
+  void setEnabled(bool enabled);
+  bool isEnabled() const;
+  void setSwaps(const QList<ColorSwap> &swaps);
+
+  // Latest preview at proxy resolution, null while none is ready. Safe to
+  // call from the QML image provider thread.
+  QImage previewImage() const;
+  bool hasPreview() const;
+
+signals:
+  void previewChanged();
+
+private:
+  struct Render {
+    quint64 generation = 0;
+    qint64 sourceKey = 0;
+    QImage proxy;
+    QImage preview;
+  };
+
+  ImageSequence *m_sequence;
+  bool m_enabled = false;
+  QList<ColorSwap> m_swaps;
+
+  QTimer *m_debounce;
+  quint64 m_generation = 0;
+  QFutureWatcher<Render> *m_watcher = nullptr;
+  bool m_rerun = false; // A request arrived while rendering
+
+  // Proxy of the frame whose cacheKey is m_proxyKey
+  QImage m_proxy;
+  qint64 m_proxyKey = 0;
+
+  mutable QMutex m_previewMutex;
+  QImage m_preview;
+
+  void schedule();
+  void startRender();
+  void onRenderFinished();
+  void setPreview(const QImage &preview);
+};
+
+#endif // SWAPPREVIEW_H
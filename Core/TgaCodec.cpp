@@ -0,0 +1,407 @@
+#include "TgaCodec.h"
+#include <QFile>
+#include <QIODevice>
+#include <QVector>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+const int HeaderSize = 18;
+
+struct TgaHeader {
+  int idLength = 0;
+  int colorMapType = 0;
+  int imageType = 0;
+  int colorMapFirst = 0;
+  int colorMapLength = 0;
+  int colorMapDepth = 0;
+  int width = 0;
+  int height = 0;
+  int pixelDepth = 0;
+  int descriptor = 0;
+};
+
+bool parseHeader(const uchar *data, qsizetype size, TgaHeader &h) {
+  if (!data || size < HeaderSize)
+    return false;
+
+  h.idLength = data[0];
+  h.colorMapType = data[1];
+  h.imageType = data[2];
+  h.colorMapFirst = qFromLittleEndian<quint16>(data + 3);
+  h.colorMapLength = qFromLittleEndian<quint16>(data + 5);
+  h.colorMapDepth = data[7];
+  h.width = qFromLittleEndian<quint16>(data + 12);
+  h.height = qFromLittleEndian<quint16>(data + 14);
+  h.pixelDepth = data[16];
+  h.descriptor = data[17];
+  return true;
+}
+
+inline int expand5(int v) { return (v << 3) | (v >> 2); }
+
+// Pixel fetchers: convert one stored pixel to QRgb
+struct FetchBgra32 {
+  static constexpr int Bpp = 4;
+  QRgb operator()(const uchar *p) const {
+    return qRgba(p[2], p[1], p[0], p[3]);
+  }
+};
+
+struct FetchBgr24 {
+  static constexpr int Bpp = 3;
+  QRgb operator()(const uchar *p) const { return qRgb(p[2], p[1], p[0]); }
+};
+
+// 5-5-5 with the attribute bit ignored, like most readers do
+struct FetchBgr16 {
+  static constexpr int Bpp = 2;
+  QRgb operator()(const uchar *p) const {
+    const int v = p[0] | (p[1] << 8);
+    return qRgb(expand5((v >> 10) & 31), expand5((v >> 5) & 31),
+                expand5(v & 31));
+  }
+};
+
+struct FetchGray8 {
+  static constexpr int Bpp = 1;
+  QRgb operator()(const uchar *p) const { return qRgb(p[0], p[0], p[0]); }
+};
+
+struct FetchGrayAlpha16 {
+  static constexpr int Bpp = 2;
+  QRgb operator()(const uchar *p) const {
+    return qRgba(p[0], p[0], p[0], p[1]);
+  }
+};
+
+struct FetchMapped8 {
+  static constexpr int Bpp = 1;
+  const QRgb *lut;
+  QRgb operator()(const uchar *p) const { return lut[p[0]]; }
+};
+
+struct FetchMapped16 {
+  static constexpr int Bpp = 2;
+  const QRgb *lut;
+  QRgb operator()(const uchar *p) const { return lut[p[0] | (p[1] << 8)]; }
+};
+
+template <typename Fetch>
+inline void convertRun(QRgb *dst, const uchar *src, int n, Fetch fetch) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  // BGRA bytes are already the in-memory layout of ARGB32
+  if constexpr (std::is_same_v<Fetch, FetchBgra32>) {
+    std::memcpy(dst, src, size_t(n) * 4);
+    return;
+  }
+#endif
+  for (int i = 0; i < n; ++i)
+    dst[i] = fetch(src + i * Fetch::Bpp);
+}
+
+// Decodes the pixel stream straight into scanlines. Packets may span rows, as
+// older writers produce. Truncated data leaves the remaining pixels
+// transparent.
+template <typename Fetch>
+void decodePixels(const uchar *src, const uchar *end, bool rle, bool topDown,
+                  bool rightToLeft, QImage &image, Fetch fetch) {
+  constexpr int Bpp = Fetch::Bpp;
+  const int w = image.width();
+  const int h = image.height();
+
+  int row = 0;
+  int x = 0;
+  auto rowPointer = [&](int r) {
+    return reinterpret_cast<QRgb *>(image.scanLine(topDown ? r : h - 1 - r));
+  };
+  QRgb *line = rowPointer(0);
+  auto nextRow = [&]() {
+    if (rightToLeft)
+      std::reverse(line, line + w);
+    x = 0;
+    if (++row < h)
+      line = rowPointer(row);
+  };
+
+  if (!rle) {
+    const qsizetype rowBytes = qsizetype(w) * Bpp;
+    while (row < h && end - src >= rowBytes) {
+      convertRun(line, src, w, fetch);
+      src += rowBytes;
+      nextRow();
+    }
+    return;
+  }
+
+  while (row < h && src < end) {
+    const int packet = *src++;
+    int count = (packet & 0x7F) + 1;
+
+    if (packet & 0x80) { // Run-length packet: one value repeated
+      if (end - src < Bpp)
+        return;
+      const QRgb value = fetch(src);
+      src += Bpp;
+      while (count > 0 && row < h) {
+        const int n = qMin(count, w - x);
+        std::fill(line + x, line + x + n, value);
+        x += n;
+        count -= n;
+        if (x == w)
+          nextRow();
+      }
+    } else { // Raw packet
+      if (end - src < qsizetype(count) * Bpp)
+        return;
+      while (count > 0 && row < h) {
+        const int n = qMin(count, w - x);
+        convertRun(line + x, src, n, fetch);
+        src += qsizetype(n) * Bpp;
+        x += n;
+        count -= n;
+        if (x == w)
+          nextRow();
+      }
+    }
+  }
+}
+
+// Expands the colour map into a lookup table addressed by the raw index
+bool buildPalette(const TgaHeader &h, const uchar *map, const uchar *end,
+                  QVector<QRgb> &lut) {
+  const int entryBytes = (h.colorMapDepth + 7) / 8;
+  lut.fill(0, h.pixelDepth == 8 ? 256 : 65536);
+
+  for (int i = 0; i < h.colorMapLength; ++i) {
+    const uchar *p = map + qsizetype(i) * entryBytes;
+    if (end - p < entryBytes)
+      return false;
+
+    const int index = h.colorMapFirst + i;
+    if (index >= lut.size())
+      break;
+
+    switch (h.colorMapDepth) {
+    case 32:
+      lut[index] = FetchBgra32()(p);
+      break;
+    case 24:
+      lut[index] = FetchBgr24()(p);
+      break;
+    case 15:
+    case 16:
+      lut[index] = FetchBgr16()(p);
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+// Appends one pixel in BGRA byte order
+inline char *storeBgra(char *out, QRgb c) {
+  out[0] = char(qBlue(c));
+  out[1] = char(qGreen(c));
+  out[2] = char(qRed(c));
+  out[3] = char(qAlpha(c));
+  return out + 4;
+}
+
+// Encodes one scanline into RLE packets. Packets never cross rows, as the
+// TGA 2.0 spec recommends. Returns the end of the written data.
+char *encodeRleRow(const QRgb *row, int w, char *out) {
+  int x = 0;
+  while (x < w) {
+    int run = 1;
+    while (x + run < w && run < 128 && row[x + run] == row[x])
+      ++run;
+
+    if (run > 1) {
+      *out++ = char(0x80 | (run - 1));
+      out = storeBgra(out, row[x]);
+      x += run;
+      continue;
+    }
+
+    // Raw packet up to the start of the next repeat
+    const int start = x++;
+    while (x < w && x - start < 128 && !(x + 1 < w && row[x] == row[x + 1]))
+      ++x;
+
+    const int count = x - start;
+    *out++ = char(count - 1);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    std::memcpy(out, row + start, size_t(count) * 4);
+    out += count * 4;
+#else
+    for (int i = start; i < x; ++i)
+      out = storeBgra(out, row[i]);
+#endif
+  }
+  return out;
+}
+
+} // namespace
+
+QImage TgaCodec::read(const QString &filePath) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return QImage();
+
+  // Map the whole file when possible; fall back to a single read
+  if (uchar *mapped = file.map(0, file.size())) {
+    QImage image = read(mapped, file.size());
+    file.unmap(mapped);
+    return image;
+  }
+
+  const QByteArray data = file.readAll();
+  return read(reinterpret_cast<const uchar *>(data.constData()), data.size());
+}
+
+QImage TgaCodec::read(const uchar *data, qsizetype size) {
+  TgaHeader h;
+  if (!parseHeader(data, size, h) || h.width == 0 || h.height == 0)
+    return QImage();
+
+  // 1/2/3 raw, 9/10/11 RLE
+  const int baseType = h.imageType & ~8;
+  if (baseType < 1 || baseType > 3)
+    return QImage();
+  const bool rle = (h.imageType & 8) != 0;
+
+  const uchar *end = data + size;
+  const uchar *colorMap = data + HeaderSize + h.idLength;
+  const qsizetype colorMapBytes =
+      h.colorMapType == 1
+          ? qsizetype(h.colorMapLength) * ((h.colorMapDepth + 7) / 8)
+          : 0;
+  const uchar *pixels = colorMap + colorMapBytes;
+  if (pixels > end)
+    return QImage();
+
+  QImage image(h.width, h.height, QImage::Format_ARGB32);
+  if (image.isNull())
+    return QImage();
+  image.fill(Qt::transparent);
+
+  const bool topDown = h.descriptor & 0x20;
+  const bool rightToLeft = h.descriptor & 0x10;
+
+  switch (baseType) {
+  case 1: { // Colour-mapped
+    QVector<QRgb> lut;
+    if (h.colorMapType != 1 || (h.pixelDepth != 8 && h.pixelDepth != 16) ||
+        !buildPalette(h, colorMap, end, lut))
+      return QImage();
+    if (h.pixelDepth == 8)
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchMapped8{lut.constData()});
+    else
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchMapped16{lut.constData()});
+    break;
+  }
+  case 2: // True-colour
+    if (h.pixelDepth == 32)
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchBgra32());
+    else if (h.pixelDepth == 24)
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchBgr24());
+    else if (h.pixelDepth == 15 || h.pixelDepth == 16)
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchBgr16());
+    else
+      return QImage();
+    break;
+  case 3: // Grayscale
+    if (h.pixelDepth == 8)
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchGray8());
+    else if (h.pixelDepth == 16)
+      decodePixels(pixels, end, rle, topDown, rightToLeft, image,
+                   FetchGrayAlpha16());
+    else
+      return QImage();
+    break;
+  }
+
+  return image;
+}
+
+QSize TgaCodec::readSize(const QString &filePath) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return QSize();
+
+  const QByteArray header = file.read(HeaderSize);
+  TgaHeader h;
+  if (!parseHeader(reinterpret_cast<const uchar *>(header.constData()),
+                   header.size(), h))
+    return QSize();
+  return QSize(h.width, h.height);
+}
+
+bool TgaCodec::write(const QImage &image, QIODevice *device, bool rle) {
+  if (image.isNull() || !device || image.width() > 0xFFFF ||
+      image.height() > 0xFFFF)
+    return false;
+
+  const QImage img = image.format() == QImage::Format_ARGB32
+                         ? image
+                         : image.convertToFormat(QImage::Format_ARGB32);
+  const int w = img.width();
+  const int h = img.height();
+
+  uchar header[HeaderSize] = {};
+  header[2] = rle ? 10 : 2;
+  qToLittleEndian<quint16>(w, header + 12);
+  qToLittleEndian<quint16>(h, header + 14);
+  header[16] = 32;
+  header[17] = 0x20 | 8; // Top-left origin, 8 alpha bits
+  if (device->write(reinterpret_cast<const char *>(header), HeaderSize) !=
+      HeaderSize)
+    return false;
+
+  // Worst case per row: all raw packets
+  QByteArray buffer(qsizetype(w) * 4 + (w + 127) / 128, Qt::Uninitialized);
+  for (int y = 0; y < h; ++y) {
+    const QRgb *row = reinterpret_cast<const QRgb *>(img.constScanLine(y));
+    const char *begin = buffer.constData();
+    qsizetype length = 0;
+
+    if (rle) {
+      length = encodeRleRow(row, w, buffer.data()) - begin;
+    } else {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+      begin = reinterpret_cast<const char *>(row);
+      length = qsizetype(w) * 4;
+#else
+      char *out = buffer.data();
+      for (int x = 0; x < w; ++x)
+        out = storeBgra(out, row[x]);
+      length = out - begin;
+#endif
+    }
+
+    if (device->write(begin, length) != length)
+      return false;
+  }
+
+  // TGA 2.0 footer without extension or developer areas
+  static const char footer[26] = "\0\0\0\0\0\0\0\0TRUEVISION-XFILE.";
+  return device->write(footer, sizeof(footer)) == qint64(sizeof(footer));
+}
+
+bool TgaCodec::write(const QImage &image, const QString &filePath, bool rle) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  return write(image, &file, rle);
+}
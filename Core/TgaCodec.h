@@ -0,0 +1,32 @@
+#ifndef TGACODEC_H
+#define TGACODEC_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+class QIODevice;
+
+// Truevision TGA support. Qt has no TGA writer and its optional reader goes
+// through QIODevice per pixel, so TGA-heavy pipelines use this codec instead.
+//
+// Reading supports colour-mapped (1/9), true-colour (2/10) and grayscale
+// (3/11) images, raw and RLE, in any origin. Decoded images are always
+// Format_ARGB32.
+//
+// Writing produces 32-bit top-left-origin true-colour images, optionally RLE
+// compressed per scanline.
+class TgaCodec {
+public:
+  static QImage read(const QString &filePath);
+  static QImage read(const uchar *data, qsizetype size);
+
+  // Parses only the header
+  static QSize readSize(const QString &filePath);
+
+  static bool write(const QImage &image, QIODevice *device, bool rle = true);
+  static bool write(const QImage &image, const QString &filePath,
+                    bool rle = true);
+};
+
+#endif // TGACODEC_H
@@ -6,6 +6,14 @@ TimelineModel::TimelineModel(ImageSequence *sequence, QObject *parent)
 
   connect(m_sequence, &ImageSequence::sequenceLoaded, this,
           &TimelineModel::onSequenceLoaded);
+  connect(m_sequence, &ImageSequence::framesCleared, this,
+          &TimelineModel::onFramesCleared);
+  // Frames are appended progressively while a sequence is loading; inserting
+  // rows keeps the delegates already shown and the scroll position
+  connect(m_sequence, &ImageSequence::framesAboutToBeAppended, this,
+          &TimelineModel::onFramesAboutToBeAppended);
+  connect(m_sequence, &ImageSequence::framesAppended, this,
+          &TimelineModel::onFramesAppended);
   connect(m_sequence, &ImageSequence::currentIndexChanged, this,
           &TimelineModel::onCurrentIndexChanged);
   connect(m_sequence, &ImageSequence::imageModified, this,
@@ -40,12 +48,23 @@ QHash<int, QByteArray> TimelineModel::roleNames() const {
           {IsSelectedRole, "isSelected"}};
 }
 
+// The rows are already in the model by the time loading finishes
 void TimelineModel::onSequenceLoaded() {
+  onCurrentIndexChanged(m_sequence->currentIndex());
+}
+
+void TimelineModel::onFramesCleared() {
   beginResetModel();
-  m_selectedIndex = m_sequence->count() > 0 ? 0 : -1;
+  m_selectedIndex = -1;
   endResetModel();
 }
 
+void TimelineModel::onFramesAboutToBeAppended(int first, int last) {
+  beginInsertRows(QModelIndex(), first, last);
+}
+
+void TimelineModel::onFramesAppended() { endInsertRows(); }
+
 void TimelineModel::onCurrentIndexChanged(int index) {
   int oldIndex = m_selectedIndex;
   m_selectedIndex = index;
@@ -21,6 +21,9 @@ public:
 
 public slots:
   void onSequenceLoaded();
+  void onFramesCleared();
+  void onFramesAboutToBeAppended(int first, int last);
+  void onFramesAppended();
   void onCurrentIndexChanged(int index);
   void onImageModified(int index);
 
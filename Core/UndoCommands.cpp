@@ -1,95 +1,342 @@
 #include "UndoCommands.h"
+#include <QtConcurrent>
+
+// Deltas from the frames' previous pixels to their current ones, one frame
+// per worker. Frames whose pixels came back identical are left out.
+static QMap<int, FrameDelta> frameDeltas(const ImageSequence *sequence,
+                                         const QMap<int, QImage> &previous) {
+  const QList<int> indices = previous.keys();
+  const QList<FrameDelta> deltas =
+      QtConcurrent::blockingMapped<QList<FrameDelta>>(
+          indices, [sequence, &previous](int index) {
+            return FrameDelta(previous.value(index), sequence->imageAt(index));
+          });
+
+  QMap<int, FrameDelta> result;
+  for (int i = 0; i < indices.size(); ++i) {
+    if (!deltas[i].isEmpty())
+      result.insert(indices[i], deltas[i]);
+  }
+  return result;
+}
+
+// Decompressing runs on the pool; frames are then stored in order. Frames
+// whose pixels the deltas were not recorded against are left alone; returns
+// how many.
+static int applyDeltas(ImageSequence *sequence,
+                       const QMap<int, FrameDelta> &deltas) {
+  const QList<int> indices = deltas.keys();
+  const QList<QImage> images = QtConcurrent::blockingMapped<QList<QImage>>(
+      indices, [sequence, &deltas](int index) {
+        return deltas[index].apply(sequence->imageAt(index));
+      });
+  int skipped = 0;
+  for (int i = 0; i < indices.size(); ++i) {
+    if (images[i].isNull())
+      ++skipped;
+    else
+      sequence->setImage(indices[i], images[i]);
+  }
+  return skipped;
+}
+
+static qint64 deltaBytes(const QMap<int, FrameDelta> &deltas) {
+  qint64 bytes = 0;
+  for (const FrameDelta &delta : deltas)
+    bytes += delta.byteCost();
+  return bytes;
+}
+
+static qint64 markerBytes(const QMap<int, QList<QcMarker>> &markers) {
+  qint64 bytes = 0;
+  for (const QList<QcMarker> &list : markers)
+    bytes += qint64(sizeof(list)) + list.size() * qint64(sizeof(QcMarker));
+  return bytes;
+}
+
+static void restoreMarkers(ImageSequence *sequence,
+                           const QMap<int, QList<QcMarker>> &markers) {
+  QMapIterator<int, QList<QcMarker>> i(markers);
+  while (i.hasNext()) {
+    i.next();
+    sequence->setMarkers(i.key(), i.value());
+  }
+}
+
+// --- HistoryCommand ---
+void HistoryCommand::expire() {
+  releaseHistory();
+  m_expired = true;
+}
 
 // --- ColorSwapCommand ---
 ColorSwapCommand::ColorSwapCommand(ImageSequence *sequence,
                                    const QList<ColorSwap> &swaps,
                                    bool allFrames, QUndoCommand *parent)
-    : QUndoCommand(parent), m_sequence(sequence), m_swaps(swaps),
+    : HistoryCommand(parent), m_sequence(sequence), m_swaps(swaps),
       m_allFrames(allFrames) {
   setText(allFrames ? "Batch Color Swap" : "Color Swap");
 }
 
 void ColorSwapCommand::undo() {
-  QMapIterator<int, QImage> i(m_undoData);
-  while (i.hasNext()) {
-    i.next();
-    m_sequence->setImage(i.key(), i.value());
-  }
+  m_skippedFrames = applyDeltas(m_sequence, m_deltas);
 }
 
 void ColorSwapCommand::redo() {
+  if (m_done) {
+    m_skippedFrames = applyDeltas(m_sequence, m_deltas);
+    return;
+  }
+
   QMap<int, QImage> result;
   if (m_allFrames) {
     result = m_sequence->replaceColorsInAllFrames(m_swaps);
   } else {
     result = m_sequence->replaceColorsInCurrentFrame(m_swaps);
   }
-
-  // Capture undo data only on the first run (when it's empty)
-  // Logic: First run (pushed to stack) -> returns original images.
-  // Subsequent redo (after undo) -> returns restored images (which are same as original).
-  // So we can just set it if empty.
-  if (m_undoData.isEmpty()) {
-    m_undoData = result;
-  }
+  // The previous images are dropped here; only the deltas stay on the stack
+  m_deltas = frameDeltas(m_sequence, result);
+  m_done = true;
 }
 
+qint64 ColorSwapCommand::byteCost() const { return deltaBytes(m_deltas); }
+
+void ColorSwapCommand::releaseHistory() { m_deltas.clear(); }
+
 // --- GuideCheckCommand ---
 GuideCheckCommand::GuideCheckCommand(ImageSequence *sequence,
                                      const QList<GuideColorParams> &params,
                                      bool allFrames, QUndoCommand *parent)
-    : QUndoCommand(parent), m_sequence(sequence), m_params(params),
+    : HistoryCommand(parent), m_sequence(sequence), m_params(params),
       m_allFrames(allFrames) {
   setText(allFrames ? "Batch Guide Check" : "Guide Check");
 }
 
-void GuideCheckCommand::undo() {
-  QMapIterator<int, QImage> i(m_undoData);
-  while (i.hasNext()) {
-    i.next();
-    m_sequence->setImage(i.key(), i.value());
-  }
-}
+void GuideCheckCommand::undo() { restoreMarkers(m_sequence, m_undoData); }
 
 void GuideCheckCommand::redo() {
-  QMap<int, QImage> result;
+  if (m_done) {
+    restoreMarkers(m_sequence, m_redoData);
+    return;
+  }
+
   if (m_allFrames) {
-    result = m_sequence->applyGuideCheckToAllFrames(m_params);
+    m_undoData = m_sequence->applyGuideCheckToAllFrames(m_params);
   } else {
-    result = m_sequence->applyGuideCheckToCurrentFrame(m_params);
+    m_undoData = m_sequence->applyGuideCheckToCurrentFrame(m_params);
   }
+  for (auto it = m_undoData.constBegin(); it != m_undoData.constEnd(); ++it)
+    m_redoData.insert(it.key(), m_sequence->markers(it.key()));
+  m_done = true;
+}
 
-  if (m_undoData.isEmpty()) {
-    m_undoData = result;
-  }
+qint64 GuideCheckCommand::byteCost() const {
+  return markerBytes(m_undoData) + markerBytes(m_redoData);
+}
+
+void GuideCheckCommand::releaseHistory() {
+  m_undoData.clear();
+  m_redoData.clear();
 }
 
 // --- AlphaCheckCommand ---
 AlphaCheckCommand::AlphaCheckCommand(ImageSequence *sequence,
                                      const AlphaCheckParams &params,
                                      bool allFrames, QUndoCommand *parent)
-    : QUndoCommand(parent), m_sequence(sequence), m_params(params),
+    : HistoryCommand(parent), m_sequence(sequence), m_params(params),
       m_allFrames(allFrames) {
   setText(allFrames ? "Batch Alpha Check" : "Alpha Check");
 }
 
-void AlphaCheckCommand::undo() {
-  QMapIterator<int, QImage> i(m_undoData);
-  while (i.hasNext()) {
-    i.next();
-    m_sequence->setImage(i.key(), i.value());
-  }
-}
+void AlphaCheckCommand::undo() { restoreMarkers(m_sequence, m_undoData); }
 
 void AlphaCheckCommand::redo() {
-  QMap<int, QImage> result;
+  if (m_done) {
+    restoreMarkers(m_sequence, m_redoData);
+    return;
+  }
+
   if (m_allFrames) {
-    result = m_sequence->applyAlphaCheckToAllFrames(m_params);
+    m_undoData = m_sequence->applyAlphaCheckToAllFrames(m_params);
   } else {
-    result = m_sequence->applyAlphaCheckToCurrentFrame(m_params);
+    m_undoData = m_sequence->applyAlphaCheckToCurrentFrame(m_params);
+  }
+  for (auto it = m_undoData.constBegin(); it != m_undoData.constEnd(); ++it)
+    m_redoData.insert(it.key(), m_sequence->markers(it.key()));
+  m_done = true;
+}
+
+qint64 AlphaCheckCommand::byteCost() const {
+  return markerBytes(m_undoData) + markerBytes(m_redoData);
+}
+
+void AlphaCheckCommand::releaseHistory() {
+  m_undoData.clear();
+  m_redoData.clear();
+}
+
+// --- SpeckCleanupCommand ---
+SpeckCleanupCommand::SpeckCleanupCommand(ImageSequence *sequence,
+                                         const SpeckCleanupParams &params,
+                                         bool allFrames, QUndoCommand *parent)
+    : HistoryCommand(parent), m_sequence(sequence), m_params(params),
+      m_allFrames(allFrames) {
+  if (params.absorb)
+    setText(allFrames ? "Batch Speck Cleanup" : "Speck Cleanup");
+  else
+    setText(allFrames ? "Batch Speck Check" : "Speck Check");
+}
+
+void SpeckCleanupCommand::undo() {
+  m_skippedFrames = applyDeltas(m_sequence, m_deltas);
+  restoreMarkers(m_sequence, m_undoMarkers);
+}
+
+void SpeckCleanupCommand::redo() {
+  if (m_done) {
+    m_skippedFrames = applyDeltas(m_sequence, m_deltas);
+    restoreMarkers(m_sequence, m_redoMarkers);
+    return;
+  }
+
+  if (m_params.absorb) {
+    m_deltas = frameDeltas(
+        m_sequence, m_allFrames
+                        ? m_sequence->absorbSpecksInAllFrames(m_params)
+                        : m_sequence->absorbSpecksInCurrentFrame(m_params));
+    m_done = true;
+    return;
+  }
+
+  m_undoMarkers = m_allFrames ? m_sequence->markSpecksInAllFrames(m_params)
+                              : m_sequence->markSpecksInCurrentFrame(m_params);
+  for (auto it = m_undoMarkers.constBegin(); it != m_undoMarkers.constEnd();
+       ++it)
+    m_redoMarkers.insert(it.key(), m_sequence->markers(it.key()));
+  m_done = true;
+}
+
+qint64 SpeckCleanupCommand::byteCost() const {
+  return deltaBytes(m_deltas) + markerBytes(m_undoMarkers) +
+         markerBytes(m_redoMarkers);
+}
+
+void SpeckCleanupCommand::releaseHistory() {
+  m_deltas.clear();
+  m_undoMarkers.clear();
+  m_redoMarkers.clear();
+}
+
+// --- PropagateColorsCommand ---
+PropagateColorsCommand::PropagateColorsCommand(ImageSequence *sequence,
+                                               const PropagationParams &params,
+                                               QUndoCommand *parent)
+    : HistoryCommand(parent), m_sequence(sequence), m_params(params) {
+  setText("Propagate Colors");
+}
+
+void PropagateColorsCommand::undo() {
+  m_skippedFrames = applyDeltas(m_sequence, m_deltas);
+  restoreMarkers(m_sequence, m_undoMarkers);
+}
+
+void PropagateColorsCommand::redo() {
+  if (m_done) {
+    m_skippedFrames = applyDeltas(m_sequence, m_deltas);
+    restoreMarkers(m_sequence, m_redoMarkers);
+    return;
+  }
+
+  m_deltas = frameDeltas(m_sequence,
+                         m_sequence->propagateColors(m_params, &m_undoMarkers));
+  for (auto it = m_undoMarkers.constBegin(); it != m_undoMarkers.constEnd();
+       ++it)
+    m_redoMarkers.insert(it.key(), m_sequence->markers(it.key()));
+  m_done = true;
+}
+
+qint64 PropagateColorsCommand::byteCost() const {
+  return deltaBytes(m_deltas) + markerBytes(m_undoMarkers) +
+         markerBytes(m_redoMarkers);
+}
+
+void PropagateColorsCommand::releaseHistory() {
+  m_deltas.clear();
+  m_undoMarkers.clear();
+  m_redoMarkers.clear();
+}
+
+// --- FillCommand ---
+FillCommand::FillCommand(ImageSequence *sequence, const FillParams &params,
+                         int firstFrame, int lastFrame, QUndoCommand *parent)
+    : HistoryCommand(parent), m_sequence(sequence), m_params(params),
+      m_firstFrame(firstFrame), m_lastFrame(lastFrame) {
+  setText(firstFrame == lastFrame ? "Bucket Fill" : "Batch Bucket Fill");
+}
+
+void FillCommand::undo() { swapBoxes(); }
+
+void FillCommand::redo() {
+  if (m_done) {
+    swapBoxes();
+    return;
+  }
+
+  const QMap<int, FramePatch> patches =
+      m_sequence->fillFrames(m_firstFrame, m_lastFrame, m_params);
+  for (auto it = patches.constBegin(); it != patches.constEnd(); ++it) {
+    const QRect &rect = it.value().rect;
+    const QImage filled = m_sequence->imageAt(it.key())
+                              .copy(rect)
+                              .convertToFormat(QImage::Format_ARGB32);
+    m_deltas.insert(it.key(), {rect, FrameDelta(it.value().image, filled)});
   }
+  m_done = true;
+  // A fill that changed nothing is dropped from the stack
+  setObsolete(m_deltas.isEmpty());
+}
+
+qint64 FillCommand::byteCost() const {
+  qint64 bytes = 0;
+  for (const BoxDelta &box : m_deltas)
+    bytes += qint64(sizeof(BoxDelta)) + box.delta.byteCost();
+  return bytes;
+}
 
-  if (m_undoData.isEmpty()) {
-    m_undoData = result;
+void FillCommand::releaseHistory() { m_deltas.clear(); }
+
+// Pastes the other version of each box over the one the frame shows
+void FillCommand::swapBoxes() {
+  m_skippedFrames = 0;
+  for (auto it = m_deltas.constBegin(); it != m_deltas.constEnd(); ++it) {
+    const QRect &rect = it.value().rect;
+    const QImage box = m_sequence->imageAt(it.key())
+                           .copy(rect)
+                           .convertToFormat(QImage::Format_ARGB32);
+    const QImage other = it.value().delta.apply(box);
+    if (other.isNull())
+      ++m_skippedFrames;
+    else
+      m_sequence->applyPatch(it.key(), {rect, other});
   }
 }
+
+// --- ClearMarkersCommand ---
+ClearMarkersCommand::ClearMarkersCommand(ImageSequence *sequence,
+                                         bool allFrames, QUndoCommand *parent)
+    : HistoryCommand(parent), m_sequence(sequence), m_allFrames(allFrames) {
+  setText(allFrames ? "Clear All QC Markers" : "Clear QC Markers");
+}
+
+void ClearMarkersCommand::undo() { restoreMarkers(m_sequence, m_undoData); }
+
+void ClearMarkersCommand::redo() {
+  // Clearing again after undo removes exactly what undo restored
+  m_undoData = m_sequence->clearMarkers(m_allFrames);
+}
+
+qint64 ClearMarkersCommand::byteCost() const {
+  return markerBytes(m_undoData);
+}
+
+void ClearMarkersCommand::releaseHistory() { m_undoData.clear(); }
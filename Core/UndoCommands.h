@@ -2,25 +2,57 @@
 #define UNDOCOMMANDS_H
 
 #include "CelPaintTypes.h"
+#include "FrameDelta.h"
 #include "ImageSequence.h"
 #include <QUndoCommand>
 
-class ColorSwapCommand : public QUndoCommand {
+// Commands report the bytes their undo data holds so AppController can keep
+// the stack to a budget. The oldest are expired to stay within it: their data
+// is released and they can no longer be undone.
+class HistoryCommand : public QUndoCommand {
+public:
+  using QUndoCommand::QUndoCommand;
+
+  virtual qint64 byteCost() const = 0;
+  void expire();
+  bool isExpired() const { return m_expired; }
+  // Frames the last undo or redo left alone because their pixels no longer
+  // match the recorded ones (e.g. reloaded from disk)
+  int skippedFrames() const { return m_skippedFrames; }
+
+protected:
+  virtual void releaseHistory() = 0;
+  int m_skippedFrames = 0;
+
+private:
+  bool m_expired = false;
+};
+
+// Pixel edits keep a FrameDelta per changed frame, which undo and redo apply
+// to the frame's current pixels
+class ColorSwapCommand : public HistoryCommand {
 public:
   ColorSwapCommand(ImageSequence *sequence, const QList<ColorSwap> &swaps,
                    bool allFrames, QUndoCommand *parent = nullptr);
 
   void undo() override;
   void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
 
 private:
   ImageSequence *m_sequence;
   QList<ColorSwap> m_swaps;
   bool m_allFrames;
-  QMap<int, QImage> m_undoData;
+  bool m_done = false;
+  QMap<int, FrameDelta> m_deltas;
 };
 
-class GuideCheckCommand : public QUndoCommand {
+// Marker commands keep only marker lists: the frame's lists before the
+// check, and after it so redo does not run detection again
+class GuideCheckCommand : public HistoryCommand {
 public:
   GuideCheckCommand(ImageSequence *sequence,
                     const QList<GuideColorParams> &params, bool allFrames,
@@ -28,27 +60,134 @@ public:
 
   void undo() override;
   void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
 
 private:
   ImageSequence *m_sequence;
   QList<GuideColorParams> m_params;
   bool m_allFrames;
-  QMap<int, QImage> m_undoData;
+  bool m_done = false;
+  QMap<int, QList<QcMarker>> m_undoData;
+  QMap<int, QList<QcMarker>> m_redoData;
 };
 
-class AlphaCheckCommand : public QUndoCommand {
+class AlphaCheckCommand : public HistoryCommand {
 public:
   AlphaCheckCommand(ImageSequence *sequence, const AlphaCheckParams &params,
                     bool allFrames, QUndoCommand *parent = nullptr);
 
   void undo() override;
   void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
 
 private:
   ImageSequence *m_sequence;
   AlphaCheckParams m_params;
   bool m_allFrames;
-  QMap<int, QImage> m_undoData;
+  bool m_done = false;
+  QMap<int, QList<QcMarker>> m_undoData;
+  QMap<int, QList<QcMarker>> m_redoData;
+};
+
+// Marks specks like the checks above, or absorbs them into the surrounding
+// colour, which keeps deltas like ColorSwapCommand
+class SpeckCleanupCommand : public HistoryCommand {
+public:
+  SpeckCleanupCommand(ImageSequence *sequence,
+                      const SpeckCleanupParams &params, bool allFrames,
+                      QUndoCommand *parent = nullptr);
+
+  void undo() override;
+  void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
+
+private:
+  ImageSequence *m_sequence;
+  SpeckCleanupParams m_params;
+  bool m_allFrames;
+  bool m_done = false;
+  QMap<int, FrameDelta> m_deltas;
+  QMap<int, QList<QcMarker>> m_undoMarkers;
+  QMap<int, QList<QcMarker>> m_redoMarkers;
+};
+
+// Keeps deltas like ColorSwapCommand and the marker lists before and after
+class PropagateColorsCommand : public HistoryCommand {
+public:
+  PropagateColorsCommand(ImageSequence *sequence,
+                         const PropagationParams &params,
+                         QUndoCommand *parent = nullptr);
+
+  void undo() override;
+  void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
+
+private:
+  ImageSequence *m_sequence;
+  PropagationParams m_params;
+  bool m_done = false;
+  QMap<int, FrameDelta> m_deltas;
+  QMap<int, QList<QcMarker>> m_undoMarkers;
+  QMap<int, QList<QcMarker>> m_redoMarkers;
+};
+
+// Keeps only a delta of the filled box of each frame
+class FillCommand : public HistoryCommand {
+public:
+  FillCommand(ImageSequence *sequence, const FillParams &params,
+              int firstFrame, int lastFrame, QUndoCommand *parent = nullptr);
+
+  void undo() override;
+  void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
+
+private:
+  struct BoxDelta {
+    QRect rect;
+    FrameDelta delta; // Between ARGB32 copies of the box
+  };
+
+  ImageSequence *m_sequence;
+  FillParams m_params;
+  int m_firstFrame;
+  int m_lastFrame;
+  bool m_done = false;
+  QMap<int, BoxDelta> m_deltas;
+
+  void swapBoxes();
+};
+
+class ClearMarkersCommand : public HistoryCommand {
+public:
+  ClearMarkersCommand(ImageSequence *sequence, bool allFrames,
+                      QUndoCommand *parent = nullptr);
+
+  void undo() override;
+  void redo() override;
+  qint64 byteCost() const override;
+
+protected:
+  void releaseHistory() override;
+
+private:
+  ImageSequence *m_sequence;
+  bool m_allFrames;
+  QMap<int, QList<QcMarker>> m_undoData;
 };
 
 #endif // UNDOCOMMANDS_H
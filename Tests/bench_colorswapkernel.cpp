@@ -0,0 +1,106 @@
+#include "ColorSwapKernel.h"
+#include <QRandomGenerator>
+#include <QTest>
+
+// Colour swaps over a 4K frame of flat fills, where runs of 8 or more pixels
+// are matched once and filled, and over a grainy frame of the same colours
+// with no runs at all, so every pixel takes the per-pixel path. Not run by
+// ctest; run by hand, e.g.
+//   bench_colorswapkernel -iterations 20
+class BenchColorSwapKernel : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void apply_data();
+  void apply();
+
+private:
+  QVector<QRgb> m_flat;
+  QVector<QRgb> m_noisy;
+  QList<ColorSwap> m_small;
+  QList<ColorSwap> m_large;
+};
+
+namespace {
+
+using Isa = ColorSwapKernel::Isa;
+
+const int Width = 3840;
+const int Height = 2160;
+
+// Swaps map colours to themselves, so every iteration sees the same frame
+ColorSwap makeSwap(QRgb color, int tolerance) {
+  ColorSwap swap;
+  swap.source = QColor::fromRgba(color);
+  swap.dest = swap.source;
+  swap.tolerance = tolerance;
+  return swap;
+}
+
+QRgb jitter(QRandomGenerator &rng, QRgb c) {
+  auto channel = [&](int v) { return qBound(0, v + rng.bounded(7) - 3, 255); };
+  return qRgba(channel(qRed(c)), channel(qGreen(c)), channel(qBlue(c)),
+               qAlpha(c));
+}
+
+} // namespace
+
+void BenchColorSwapKernel::initTestCase() {
+  QRandomGenerator rng(1);
+  QVector<QRgb> palette;
+  for (int i = 0; i < 24; ++i)
+    palette.append(rng.generate() | 0xff000000u);
+
+  // Half the palette is swapped, exactly or within a small tolerance; the
+  // large table adds unrelated swaps past the linear-scan limit
+  for (int i = 0; i < 12; ++i)
+    m_small.append(makeSwap(palette[i], i % 2 ? 6 : 0));
+  m_large = m_small;
+  for (int i = 0; i < 48; ++i)
+    m_large.append(makeSwap(rng.generate() | 0xff000000u, i % 2 ? 6 : 0));
+  QVERIFY(!ColorSwapKernel(m_small).isIndexed());
+  QVERIFY(ColorSwapKernel(m_large).isIndexed());
+
+  // Cells of one colour between 2-pixel black lines, like a painted cel
+  m_flat.resize(qsizetype(Width) * Height);
+  m_noisy.resize(m_flat.size());
+  for (int y = 0; y < Height; ++y) {
+    for (int x = 0; x < Width; ++x) {
+      const qsizetype i = qsizetype(y) * Width + x;
+      const int cell = (y / 61) * 64 + x / 97;
+      m_flat[i] = x % 97 < 2 || y % 61 < 2
+                      ? 0xff000000u
+                      : palette[(cell * 7) % palette.size()];
+      m_noisy[i] = jitter(rng, m_flat[i]);
+    }
+  }
+}
+
+void BenchColorSwapKernel::apply_data() {
+  QTest::addColumn<bool>("noisy");
+  QTest::addColumn<bool>("large");
+  QTest::addColumn<int>("isa");
+  for (bool noisy : {false, true}) {
+    const char *frame = noisy ? "noisy" : "flat";
+    QTest::addRow("%s/scalar", frame) << noisy << false << int(Isa::Scalar);
+    QTest::addRow("%s/sse2", frame) << noisy << false << int(Isa::Sse2);
+    QTest::addRow("%s/avx2", frame) << noisy << false << int(Isa::Avx2);
+    // Indexed tables take the lookup path on every instruction set
+    QTest::addRow("%s/indexed", frame) << noisy << true << int(Isa::Scalar);
+  }
+}
+
+void BenchColorSwapKernel::apply() {
+  QFETCH(bool, noisy);
+  QFETCH(bool, large);
+  QFETCH(int, isa);
+  const ColorSwapKernel kernel(large ? m_large : m_small);
+  QVector<QRgb> &frame = noisy ? m_noisy : m_flat;
+  QBENCHMARK {
+    kernel.apply(frame.data(), frame.size(), Isa(isa));
+  }
+}
+
+QTEST_APPLESS_MAIN(BenchColorSwapKernel)
+#include "bench_colorswapkernel.moc"
@@ -0,0 +1,196 @@
+#include "TgaCodec.h"
+#include <QBuffer>
+#include <QColor>
+#include <QDataStream>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTest>
+
+// Reading and writing a 4K cel frame with the codec, against the QDataStream
+// loader it replaced. Not run by ctest; run by hand, e.g.
+//   bench_tgacodec -iterations 10
+class BenchTgaCodec : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void legacyRead_data();
+  void legacyRead();
+  void read_data();
+  void read();
+  void write_data();
+  void write();
+
+private:
+  QTemporaryDir m_dir;
+  QImage m_frame;
+
+  QString path(bool rle) const;
+};
+
+namespace {
+
+// The loader as it was before TgaCodec, with only its dead code removed
+QImage legacyLoadTga(const QString &filePath) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return QImage();
+
+  QDataStream in(&file);
+  in.setByteOrder(QDataStream::LittleEndian);
+
+  quint8 idLength, colorMapType, imageType;
+  quint16 width, height;
+  quint8 pixelDepth, descriptor;
+
+  in >> idLength >> colorMapType >> imageType;
+  in.skipRawData(5); // Skip color map spec
+  in.skipRawData(4); // Skip x, y origin
+  in >> width >> height >> pixelDepth >> descriptor;
+
+  // Only support TrueColor (2) and RLE TrueColor (10)
+  // Supports 24 and 32 bit depth
+  if ((imageType != 2 && imageType != 10) ||
+      (pixelDepth != 24 && pixelDepth != 32)) {
+    return QImage();
+  }
+
+  in.skipRawData(idLength); // Skip ID field
+
+  QImage image(width, height, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+
+  bool isRLE = (imageType == 10);
+  int bytesPerPixel = pixelDepth / 8;
+  quint64 totalPixels = width * height;
+  quint64 currentPixel = 0;
+
+  while (currentPixel < totalPixels && !in.atEnd()) {
+    quint8 chunkHeader;
+    if (isRLE) {
+      in >> chunkHeader;
+    } else {
+      chunkHeader = 127; // Treat as raw packet of max length 128 (0-127)
+    }
+
+    bool isRaw = !isRLE || (chunkHeader < 128);
+    int chunkCount = (chunkHeader & 0x7F) + 1;
+
+    if (isRaw) { // Raw packet
+      for (int i = 0; i < chunkCount; ++i) {
+        if (currentPixel >= totalPixels)
+          break;
+
+        quint8 b, g, r, a = 255;
+        in >> b >> g >> r;
+        if (bytesPerPixel == 4)
+          in >> a;
+
+        int x = currentPixel % width;
+        int y = currentPixel / width;
+        if (!(descriptor & 0x20))
+          y = height - 1 - y; // TGA is bottom-up unless bit 5 set
+
+        image.setPixelColor(x, y, QColor(r, g, b, a));
+        currentPixel++;
+      }
+    } else { // RLE packet (Run-length)
+      quint8 b, g, r, a = 255;
+      in >> b >> g >> r;
+      if (bytesPerPixel == 4)
+        in >> a;
+      QColor color(r, g, b, a);
+
+      for (int i = 0; i < chunkCount; ++i) {
+        if (currentPixel >= totalPixels)
+          break;
+
+        int x = currentPixel % width;
+        int y = currentPixel / width;
+        if (!(descriptor & 0x20))
+          y = height - 1 - y;
+
+        image.setPixelColor(x, y, color);
+        currentPixel++;
+      }
+    }
+  }
+
+  return image;
+}
+
+// Flat fills between black lines, with one noisy patch like a painted
+// background, so RLE meets both long runs and raw packets
+QImage celFrame() {
+  QRandomGenerator rng(1);
+  QImage frame(3840, 2160, QImage::Format_ARGB32);
+  for (int y = 0; y < frame.height(); ++y) {
+    QRgb *line = reinterpret_cast<QRgb *>(frame.scanLine(y));
+    for (int x = 0; x < frame.width(); ++x) {
+      const int cell = (y / 61) * 64 + x / 97;
+      if (x % 97 < 2 || y % 61 < 2)
+        line[x] = 0xff000000u;
+      else if (x < 512 && y < 512)
+        line[x] = rng.generate() | 0xff000000u;
+      else
+        line[x] = 0xff000000u | quint32(cell * 2654435761u >> 8);
+    }
+  }
+  return frame;
+}
+
+void addRleRows() {
+  QTest::addColumn<bool>("rle");
+  QTest::newRow("raw") << false;
+  QTest::newRow("rle") << true;
+}
+
+} // namespace
+
+QString BenchTgaCodec::path(bool rle) const {
+  return m_dir.filePath(rle ? "rle.tga" : "raw.tga");
+}
+
+void BenchTgaCodec::initTestCase() {
+  QVERIFY(m_dir.isValid());
+  m_frame = celFrame();
+  for (bool rle : {false, true}) {
+    QVERIFY(TgaCodec::write(m_frame, path(rle), rle));
+    // Both readers must agree before their timings mean anything
+    QCOMPARE(TgaCodec::read(path(rle)), m_frame);
+    QCOMPARE(legacyLoadTga(path(rle)), m_frame);
+  }
+}
+
+void BenchTgaCodec::legacyRead_data() { addRleRows(); }
+
+void BenchTgaCodec::legacyRead() {
+  QFETCH(bool, rle);
+  QBENCHMARK {
+    legacyLoadTga(path(rle));
+  }
+}
+
+void BenchTgaCodec::read_data() { addRleRows(); }
+
+void BenchTgaCodec::read() {
+  QFETCH(bool, rle);
+  QBENCHMARK {
+    TgaCodec::read(path(rle));
+  }
+}
+
+void BenchTgaCodec::write_data() { addRleRows(); }
+
+void BenchTgaCodec::write() {
+  QFETCH(bool, rle);
+  QBENCHMARK {
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    TgaCodec::write(m_frame, &buffer, rle);
+  }
+}
+
+QTEST_APPLESS_MAIN(BenchTgaCodec)
+#include "bench_tgacodec.moc"
@@ -0,0 +1,195 @@
+#include "ColorSwapKernel.h"
+#include <QRandomGenerator>
+#include <QTest>
+
+// The SSE2 and AVX2 paths must give the scalar result byte for byte. The
+// kernel fills runs of 8 or more identical pixels without going through
+// either path, so the inputs here are mostly noise.
+class TestColorSwapKernel : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void randomTables();
+  void tails();
+  void toleranceEdges();
+};
+
+namespace {
+
+using Isa = ColorSwapKernel::Isa;
+
+ColorSwap makeSwap(QRgb source, QRgb dest, int tolerance,
+                   ColorMetric metric = ColorMetric::PerChannel) {
+  ColorSwap swap;
+  swap.source = QColor::fromRgba(source);
+  swap.dest = QColor::fromRgba(dest);
+  swap.tolerance = tolerance;
+  swap.metric = metric;
+  return swap;
+}
+
+// Channel value near v: within reach of the tolerance, or just past it
+int nearChannel(QRandomGenerator &rng, int v, int tolerance) {
+  const int reach = qMin(tolerance, 253) + 2;
+  return qBound(0, v + int(rng.bounded(2 * reach + 1)) - reach, 255);
+}
+
+QRgb nearColor(QRandomGenerator &rng, QRgb c, int tolerance) {
+  return qRgba(nearChannel(rng, qRed(c), tolerance),
+               nearChannel(rng, qGreen(c), tolerance),
+               nearChannel(rng, qBlue(c), tolerance),
+               nearChannel(rng, qAlpha(c), tolerance));
+}
+
+QList<ColorSwap> randomTable(QRandomGenerator &rng, int size) {
+  static const int tolerances[] = {0, 0, 1, 7, 32, 128, 254, 255};
+  QList<ColorSwap> swaps;
+  for (int i = 0; i < size; ++i) {
+    ColorSwap swap = makeSwap(rng.generate(), rng.generate(),
+                              tolerances[rng.bounded(8)]);
+    swap.enabled = rng.bounded(8) != 0;
+    swaps.append(swap);
+  }
+  return swaps;
+}
+
+// Pixels at, near and away from the table's sources, in runs of 1 to 12
+QVector<QRgb> randomPixels(QRandomGenerator &rng,
+                           const QList<ColorSwap> &swaps, int count) {
+  QVector<QRgb> pixels;
+  while (pixels.size() < count) {
+    QRgb c = rng.generate();
+    if (!swaps.isEmpty() && rng.bounded(4) != 0) {
+      const ColorSwap &swap = swaps[rng.bounded(int(swaps.size()))];
+      c = rng.bounded(3) == 0 ? swap.source.rgba()
+                              : nearColor(rng, swap.source.rgba(),
+                                          swap.tolerance);
+    }
+    const int run = 1 + rng.bounded(12);
+    for (int i = 0; i < run && pixels.size() < count; ++i)
+      pixels.append(c);
+  }
+  return pixels;
+}
+
+// Position of the first differing pixel, -1 if none
+qsizetype firstDifference(const QVector<QRgb> &a, const QVector<QRgb> &b) {
+  for (qsizetype i = 0; i < a.size(); ++i) {
+    if (a[i] != b[i])
+      return i;
+  }
+  return -1;
+}
+
+// Runs pixels[offset..] through every path and compares with the scalar one
+// and with map() pixel by pixel
+void checkParity(const ColorSwapKernel &kernel, const QVector<QRgb> &pixels,
+                 int offset = 0) {
+  const qsizetype count = pixels.size() - offset;
+
+  QVector<QRgb> expected = pixels;
+  bool expectedHit = false;
+  for (qsizetype i = offset; i < pixels.size(); ++i)
+    expectedHit |= kernel.map(pixels[i], &expected[i]);
+
+  for (Isa isa : {Isa::Scalar, Isa::Sse2, Isa::Avx2}) {
+    QVector<QRgb> out = pixels;
+    const bool hit = kernel.apply(out.data() + offset, count, isa);
+    const qsizetype diff = firstDifference(out, expected);
+    if (diff >= 0)
+      QFAIL(qPrintable(QString("Path %1 differs at pixel %2 of %3: %4 "
+                               "instead of %5")
+                           .arg(int(isa))
+                           .arg(diff)
+                           .arg(pixels.size())
+                           .arg(out[diff], 8, 16, QChar('0'))
+                           .arg(expected[diff], 8, 16, QChar('0'))));
+    QCOMPARE(hit, expectedHit);
+  }
+}
+
+} // namespace
+
+void TestColorSwapKernel::initTestCase() {
+  // Forced paths the CPU lacks fall back to scalar and pass trivially
+  const Isa best = ColorSwapKernel::bestIsa();
+  qInfo("Best path on this CPU: %s",
+        best == Isa::Avx2   ? "AVX2"
+        : best == Isa::Sse2 ? "SSE2"
+                            : "scalar");
+}
+
+void TestColorSwapKernel::randomTables() {
+  QRandomGenerator rng(1);
+  for (int round = 0; round < 200; ++round) {
+    const QList<ColorSwap> swaps = randomTable(rng, 1 + rng.bounded(16));
+    const ColorSwapKernel kernel(swaps);
+    if (kernel.isEmpty())
+      continue;
+    checkParity(kernel, randomPixels(rng, swaps, 1 + rng.bounded(2000)));
+    if (QTest::currentTestFailed())
+      return;
+  }
+
+  // Indexed lookup and non-box metrics take their own path on every ISA
+  const QList<ColorSwap> large = randomTable(rng, 40);
+  checkParity(ColorSwapKernel(large), randomPixels(rng, large, 3000));
+  QList<ColorSwap> generic = randomTable(rng, 6);
+  generic.append(makeSwap(rng.generate(), rng.generate(), 40,
+                          ColorMetric::EuclideanRgb));
+  checkParity(ColorSwapKernel(generic), randomPixels(rng, generic, 3000));
+}
+
+// Every count up to a few vector widths, from aligned and unaligned starts
+void TestColorSwapKernel::tails() {
+  QRandomGenerator rng(2);
+  const QList<ColorSwap> swaps = randomTable(rng, 5);
+  const ColorSwapKernel kernel(swaps);
+  for (int count = 0; count <= 40; ++count) {
+    for (int offset = 0; offset < 4; ++offset) {
+      checkParity(kernel, randomPixels(rng, swaps, count + offset), offset);
+      if (QTest::currentTestFailed())
+        return;
+    }
+  }
+}
+
+// Channels exactly at the tolerance match and one past it do not, including
+// tolerances of 0 and 255 and sources at the ends of the byte range
+void TestColorSwapKernel::toleranceEdges() {
+  static const int tolerances[] = {0, 1, 127, 254, 255};
+  static const QRgb sources[] = {0x00000000u, 0xffffffffu, 0x80ff0040u,
+                                 0x7f01fe80u};
+  for (int tolerance : tolerances) {
+    for (QRgb source : sources) {
+      const ColorSwapKernel kernel({makeSwap(source, 0x12345678u, tolerance)});
+      QVector<QRgb> pixels;
+      for (int shift = 0; shift < 32; shift += 8) {
+        const int v = int((source >> shift) & 0xff);
+        for (int delta : {-tolerance - 1, -tolerance, tolerance,
+                          tolerance + 1}) {
+          const int c = v + delta;
+          if (c < 0 || c > 255)
+            continue;
+          pixels.append((source & ~(0xffu << shift)) | (quint32(c) << shift));
+        }
+        pixels.append(source & ~(0xffu << shift));
+        pixels.append(source | (0xffu << shift));
+      }
+      checkParity(kernel, pixels);
+      for (int offset = 1; offset < 4; ++offset)
+        checkParity(kernel, pixels, offset);
+      if (QTest::currentTestFailed())
+        return;
+
+      // The exact boundary itself matches on every path
+      QVector<QRgb> edge{qRgba(qMin(255, qRed(source) + tolerance),
+                               qGreen(source), qBlue(source), qAlpha(source))};
+      QVERIFY(kernel.apply(edge.data(), edge.size(), Isa::Scalar));
+    }
+  }
+}
+
+QTEST_APPLESS_MAIN(TestColorSwapKernel)
+#include "tst_colorswapkernel.moc"
@@ -0,0 +1,260 @@
+#include "RegionLabeler.h"
+#include <QRandomGenerator>
+#include <QTest>
+
+// Labelling in bands of rows must give exactly the regions and label map of
+// one sequential pass, whatever the band height; relabelling an edited area
+// must give the regions of a full pass over the edited plane
+class TestRegionLabeler : public QObject {
+  Q_OBJECT
+
+private slots:
+  void randomPlanes();
+  void seamShapes();
+  void diagonalContacts();
+  void paddedRows();
+  void colors();
+  void relabel();
+};
+
+namespace {
+
+struct Plane {
+  int width = 0;
+  int height = 0;
+  qsizetype bytesPerLine = 0;
+  QVector<uchar> keys;
+
+  Plane(int w, int h, qsizetype stride = -1)
+      : width(w), height(h), bytesPerLine(stride < 0 ? w : stride),
+        keys(bytesPerLine * h, 0) {}
+
+  uchar &at(int x, int y) { return keys[y * bytesPerLine + x]; }
+};
+
+const int BandHeights[] = {1, 2, 3, 5, 7, 16, 64};
+
+QString describe(const Region &r) {
+  return QString("key %1 area %2 sum (%3, %4) bounds (%5, %6) %7x%8 first "
+                 "(%9)")
+      .arg(r.key)
+      .arg(r.area)
+      .arg(r.sumX)
+      .arg(r.sumY)
+      .arg(r.bounds.x())
+      .arg(r.bounds.y())
+      .arg(r.bounds.width())
+      .arg(r.bounds.height())
+      .arg(QString("%1, %2").arg(r.firstPixel.x()).arg(r.firstPixel.y()));
+}
+
+bool sameRegion(const Region &a, const Region &b) {
+  return a.key == b.key && a.area == b.area && a.sumX == b.sumX &&
+         a.sumY == b.sumY && a.bounds == b.bounds &&
+         a.firstPixel == b.firstPixel;
+}
+
+// Compares the regions and label map of the last label() of each labeler
+void compareLabelers(const RegionLabeler &banded,
+                     const RegionLabeler &sequential, int bandRows) {
+  const QVector<Region> &expected = sequential.regions();
+  const QVector<Region> &actual = banded.regions();
+  QVERIFY2(actual.size() == expected.size(),
+           qPrintable(QString("%1 regions instead of %2 with %3-row bands")
+                          .arg(actual.size())
+                          .arg(expected.size())
+                          .arg(bandRows)));
+  for (qsizetype i = 0; i < expected.size(); ++i) {
+    if (!sameRegion(actual[i], expected[i]))
+      QFAIL(qPrintable(QString("Region %1 with %2-row bands: %3, expected %4")
+                           .arg(i)
+                           .arg(bandRows)
+                           .arg(describe(actual[i]), describe(expected[i]))));
+  }
+  QVERIFY2(banded.labelMap() == sequential.labelMap(),
+           qPrintable(QString("Label maps differ with %1-row bands")
+                          .arg(bandRows)));
+}
+
+// Label map painted from regionRuns()
+QVector<int> mapOfRuns(const RegionLabeler &labeler, int width, int height) {
+  QVector<int> map(qsizetype(width) * height, -1);
+  for (const RegionLabeler::RegionRun &run : labeler.regionRuns()) {
+    for (int x = run.x0; x < run.x1; ++x)
+      map[qsizetype(run.y) * width + x] = run.region;
+  }
+  return map;
+}
+
+void checkPlane(const Plane &plane) {
+  RegionLabeler sequential;
+  sequential.label(plane.keys.constData(), plane.width, plane.height,
+                   plane.bytesPerLine);
+  QVERIFY(mapOfRuns(sequential, plane.width, plane.height) ==
+          sequential.labelMap());
+  for (int bandRows : BandHeights) {
+    RegionLabeler banded;
+    banded.setBandRows(bandRows);
+    banded.label(plane.keys.constData(), plane.width, plane.height,
+                 plane.bytesPerLine);
+    compareLabelers(banded, sequential, bandRows);
+    if (QTest::currentTestFailed())
+      return;
+  }
+}
+
+} // namespace
+
+void TestRegionLabeler::randomPlanes() {
+  QRandomGenerator rng(1);
+  for (int round = 0; round < 150; ++round) {
+    Plane plane(1 + rng.bounded(90), 1 + rng.bounded(90));
+    // Few classes and a varying amount of background give both large
+    // winding regions and noise
+    const int classes = 1 + rng.bounded(3);
+    const int background = rng.bounded(4);
+    for (int y = 0; y < plane.height; ++y) {
+      for (int x = 0; x < plane.width; ++x) {
+        const int v = rng.bounded(classes + background);
+        plane.at(x, y) = uchar(v < classes ? v + 1 : 0);
+      }
+    }
+    checkPlane(plane);
+    if (QTest::currentTestFailed())
+      return;
+  }
+}
+
+// Regions that only join, or only part, below or above a seam
+void TestRegionLabeler::seamShapes() {
+  Plane plane(40, 33);
+  for (int y = 0; y < plane.height; ++y) {
+    // Full-height stripe crossing every seam
+    plane.at(1, y) = 1;
+    // U open at the top: arms meet only on the last row
+    plane.at(5, y) = 2;
+    plane.at(9, y) = 2;
+    // Inverted U: arms meet only on the first row
+    plane.at(13, y) = 3;
+    plane.at(17, y) = 3;
+    // Staircase stepping right one pixel per row, joined by edges
+    if (y + 20 < plane.width)
+      plane.at(y + 20, y) = plane.at(qMin(y + 21, plane.width - 1), y) = 4;
+  }
+  for (int x = 5; x <= 9; ++x)
+    plane.at(x, plane.height - 1) = 2;
+  for (int x = 13; x <= 17; ++x)
+    plane.at(x, 0) = 3;
+  // Spiral-like region whose first pixel is in the last band
+  for (int x = 24; x < 40; ++x)
+    plane.at(x, 32) = 5;
+  for (int y = 20; y < 33; ++y)
+    plane.at(39, y) = 5;
+  checkPlane(plane);
+}
+
+// Pixels touching only at corners are separate regions, also across seams
+void TestRegionLabeler::diagonalContacts() {
+  Plane checker(31, 29);
+  for (int y = 0; y < checker.height; ++y) {
+    for (int x = 0; x < checker.width; ++x)
+      checker.at(x, y) = uchar((x + y) % 2 ? 1 : 2);
+  }
+  checkPlane(checker);
+  if (QTest::currentTestFailed())
+    return;
+
+  Plane diagonal(20, 20);
+  for (int i = 0; i < 20; ++i) {
+    diagonal.at(i, i) = 1;
+    diagonal.at(19 - i, i) = 2;
+  }
+  checkPlane(diagonal);
+  if (QTest::currentTestFailed())
+    return;
+
+  RegionLabeler labeler;
+  labeler.setBandRows(1);
+  labeler.label(diagonal.keys.constData(), diagonal.width, diagonal.height);
+  QCOMPARE(labeler.regions().size(), qsizetype(40));
+}
+
+// Rows with padding past the width, which must not join regions
+void TestRegionLabeler::paddedRows() {
+  QRandomGenerator rng(2);
+  Plane plane(37, 41, 48);
+  for (int y = 0; y < plane.height; ++y) {
+    for (int x = 0; x < plane.bytesPerLine; ++x)
+      plane.at(x, y) = uchar(x < plane.width ? rng.bounded(3) : 1);
+  }
+  checkPlane(plane);
+}
+
+void TestRegionLabeler::colors() {
+  QRandomGenerator rng(3);
+  QImage image(53, 47, QImage::Format_ARGB32);
+  const QRgb palette[] = {0xff000000u, 0xffffffffu, 0xffff0000u, 0x00000000u};
+  for (int y = 0; y < image.height(); ++y) {
+    for (int x = 0; x < image.width(); ++x)
+      image.setPixel(x, y, palette[rng.bounded(4)]);
+  }
+
+  RegionLabeler sequential;
+  sequential.labelColors(image);
+  for (int bandRows : BandHeights) {
+    RegionLabeler banded;
+    banded.setBandRows(bandRows);
+    banded.labelColors(image);
+    compareLabelers(banded, sequential, bandRows);
+    if (QTest::currentTestFailed())
+      return;
+  }
+}
+
+// Random edits, from single pixels to blocks that join or split regions
+void TestRegionLabeler::relabel() {
+  QRandomGenerator rng(4);
+  for (int round = 0; round < 300; ++round) {
+    Plane plane(1 + rng.bounded(60), 1 + rng.bounded(60));
+    const int classes = 1 + rng.bounded(3);
+    for (uchar &key : plane.keys)
+      key = uchar(rng.bounded(classes + 2) % (classes + 1));
+    RegionLabeler labeler;
+    const QVector<Region> before =
+        labeler.label(plane.keys.constData(), plane.width, plane.height);
+
+    const int x = rng.bounded(plane.width);
+    const int y = rng.bounded(plane.height);
+    const QRect dirty(x, y, 1 + rng.bounded(plane.width - x),
+                      1 + rng.bounded(qMin(plane.height - y, 8)));
+    const uchar fill = uchar(rng.bounded(classes + 1));
+    for (int dy = dirty.top(); dy <= dirty.bottom(); ++dy) {
+      for (int dx = dirty.left(); dx <= dirty.right(); ++dx)
+        plane.at(dx, dy) = rng.bounded(4) ? fill : uchar(rng.bounded(4));
+    }
+
+    auto keysOf = [&plane](const QRect &rect) {
+      QVector<uchar> keys;
+      for (int ky = rect.top(); ky <= rect.bottom(); ++ky) {
+        for (int kx = rect.left(); kx <= rect.right(); ++kx)
+          keys.append(plane.at(kx, ky));
+      }
+      return keys;
+    };
+    const QVector<Region> relabelled = labeler.relabel(
+        before, QSize(plane.width, plane.height), dirty, keysOf);
+    const QVector<Region> expected =
+        labeler.label(plane.keys.constData(), plane.width, plane.height);
+    QCOMPARE(relabelled.size(), expected.size());
+    for (qsizetype i = 0; i < expected.size(); ++i) {
+      if (!sameRegion(relabelled[i], expected[i]))
+        QFAIL(qPrintable(QString("Region %1 after relabelling: %2, expected %3")
+                             .arg(i)
+                             .arg(describe(relabelled[i]),
+                                  describe(expected[i]))));
+    }
+  }
+}
+
+QTEST_APPLESS_MAIN(TestRegionLabeler)
+#include "tst_regionlabeler.moc"
@@ -0,0 +1,343 @@
+#include "TgaCodec.h"
+#include <QBuffer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTest>
+
+// Every image type the reader supports, against files encoded by hand in all
+// four origins, raw and RLE. The RLE encoder here packs the pixel stream as a
+// whole, so packets cross rows the way older writers produce them.
+class TestTgaCodec : public QObject {
+  Q_OBJECT
+
+private slots:
+  void trueColor();
+  void grayscale();
+  void colorMapped();
+  void packetsCrossRows();
+  void truncated();
+  void roundTrip();
+};
+
+namespace {
+
+// Bottom-left, top-left, bottom-right and top-right
+const int Origins[] = {0x00, 0x20, 0x10, 0x30};
+const QSize Sizes[] = {QSize(1, 1), QSize(1, 9), QSize(7, 5), QSize(13, 11),
+                       QSize(150, 3)};
+
+// A stored pixel and the colour it decodes to
+struct Encoding {
+  QByteArray stored;
+  QRgb color = 0;
+};
+
+// The decoded image, with the stored bytes of each pixel in its raster order
+struct Sample {
+  QImage expected;
+  QVector<QByteArray> stored;
+};
+
+struct ColorMap {
+  int first = 0;
+  int length = 0;
+  int depth = 0;
+  QByteArray entries;
+};
+
+inline int expand5(int v) { return (v << 3) | (v >> 2); }
+
+QByteArray bytes(std::initializer_list<int> values) {
+  QByteArray result;
+  for (int v : values)
+    result.append(char(v));
+  return result;
+}
+
+QByteArray word(int v) { return bytes({v & 0xff, v >> 8}); }
+
+// Runs of 1 to 12 pixels of the given encodings
+Sample randomSample(QRandomGenerator &rng, QSize size,
+                    const QVector<Encoding> &encodings) {
+  Sample sample;
+  sample.expected = QImage(size, QImage::Format_ARGB32);
+  Encoding value;
+  int left = 0;
+  for (int y = 0; y < size.height(); ++y) {
+    for (int x = 0; x < size.width(); ++x, --left) {
+      if (left == 0) {
+        value = encodings[rng.bounded(int(encodings.size()))];
+        left = 1 + rng.bounded(12);
+      }
+      sample.expected.setPixel(x, y, value.color);
+      sample.stored.append(value.stored);
+    }
+  }
+  return sample;
+}
+
+QByteArray encode(const Sample &sample, int type, int depth, int descriptor,
+                  const ColorMap &map = ColorMap()) {
+  const int w = sample.expected.width();
+  const int h = sample.expected.height();
+  const QByteArray id("celpaint");
+
+  QByteArray file =
+      bytes({int(id.size()), map.entries.isEmpty() ? 0 : 1, type});
+  file += word(map.first) + word(map.length) + bytes({map.depth});
+  file += word(0) + word(0) + word(w) + word(h) + bytes({depth, descriptor});
+  file += id + map.entries;
+
+  QVector<QByteArray> stream;
+  for (int r = 0; r < h; ++r) {
+    const int y = descriptor & 0x20 ? r : h - 1 - r;
+    for (int c = 0; c < w; ++c) {
+      const int x = descriptor & 0x10 ? w - 1 - c : c;
+      stream.append(sample.stored[qsizetype(y) * w + x]);
+    }
+  }
+  if (!(type & 8)) {
+    for (const QByteArray &pixel : stream)
+      file += pixel;
+    return file;
+  }
+
+  qsizetype i = 0;
+  while (i < stream.size()) {
+    int run = 1;
+    while (i + run < stream.size() && run < 128 &&
+           stream[i + run] == stream[i])
+      ++run;
+    if (run > 1) {
+      file += bytes({0x80 | (run - 1)}) + stream[i];
+      i += run;
+      continue;
+    }
+    const qsizetype start = i++;
+    while (i < stream.size() && i - start < 128 &&
+           !(i + 1 < stream.size() && stream[i] == stream[i + 1]))
+      ++i;
+    file += bytes({int(i - start - 1)});
+    for (qsizetype j = start; j < i; ++j)
+      file += stream[j];
+  }
+  return file;
+}
+
+QImage decode(const QByteArray &file) {
+  return TgaCodec::read(reinterpret_cast<const uchar *>(file.constData()),
+                        file.size());
+}
+
+void compareImages(const QImage &image, const QImage &expected,
+                   const QString &what) {
+  if (image.isNull())
+    QFAIL(qPrintable(what + ": not decoded"));
+  QCOMPARE(image.format(), QImage::Format_ARGB32);
+  QCOMPARE(image.size(), expected.size());
+  for (int y = 0; y < expected.height(); ++y) {
+    for (int x = 0; x < expected.width(); ++x) {
+      if (image.pixel(x, y) != expected.pixel(x, y))
+        QFAIL(qPrintable(QString("%1: pixel (%2, %3) is %4 instead of %5")
+                             .arg(what)
+                             .arg(x)
+                             .arg(y)
+                             .arg(image.pixel(x, y), 8, 16, QChar('0'))
+                             .arg(expected.pixel(x, y), 8, 16, QChar('0'))));
+    }
+  }
+}
+
+// Raw and RLE in every origin and size
+void checkType(QRandomGenerator &rng, int baseType, int depth,
+               const QVector<Encoding> &encodings,
+               const ColorMap &map = ColorMap()) {
+  for (int type : {baseType, baseType | 8}) {
+    for (int origin : Origins) {
+      for (const QSize &size : Sizes) {
+        const Sample sample = randomSample(rng, size, encodings);
+        compareImages(decode(encode(sample, type, depth, origin, map)),
+                      sample.expected,
+                      QString("Type %1, %2 bits, descriptor %3, %4x%5")
+                          .arg(type)
+                          .arg(depth)
+                          .arg(origin, 2, 16, QChar('0'))
+                          .arg(size.width())
+                          .arg(size.height()));
+        if (QTest::currentTestFailed())
+          return;
+      }
+    }
+  }
+}
+
+} // namespace
+
+void TestTgaCodec::trueColor() {
+  QRandomGenerator rng(1);
+  QVector<Encoding> bgra, bgr, bgr16;
+  for (int i = 0; i < 12; ++i) {
+    const QRgb c = rng.generate();
+    bgra.append({bytes({qBlue(c), qGreen(c), qRed(c), qAlpha(c)}), c});
+    bgr.append({bytes({qBlue(c), qGreen(c), qRed(c)}), c | 0xff000000u});
+    // The attribute bit is ignored
+    const int v = rng.bounded(0x10000);
+    bgr16.append({word(v), qRgb(expand5((v >> 10) & 31),
+                                expand5((v >> 5) & 31), expand5(v & 31))});
+  }
+  checkType(rng, 2, 32, bgra);
+  checkType(rng, 2, 24, bgr);
+  checkType(rng, 2, 16, bgr16);
+  checkType(rng, 2, 15, bgr16);
+}
+
+void TestTgaCodec::grayscale() {
+  QRandomGenerator rng(2);
+  QVector<Encoding> gray, grayAlpha;
+  for (int v : {0, 1, 127, 128, 254, 255}) {
+    gray.append({bytes({v}), qRgb(v, v, v)});
+    const int a = rng.bounded(256);
+    grayAlpha.append({bytes({v, a}), qRgba(v, v, v, a)});
+  }
+  checkType(rng, 3, 8, gray);
+  checkType(rng, 3, 16, grayAlpha);
+}
+
+// Maps that start past index 0, in each entry depth, with 8 and 16-bit indices
+void TestTgaCodec::colorMapped() {
+  QRandomGenerator rng(3);
+  for (int mapDepth : {15, 16, 24, 32}) {
+    for (int indexDepth : {8, 16}) {
+      ColorMap map;
+      map.first = indexDepth == 8 ? 3 : 300;
+      map.length = 20;
+      map.depth = mapDepth;
+      QVector<Encoding> encodings;
+      for (int i = 0; i < map.length; ++i) {
+        const QRgb c = rng.generate();
+        QRgb color = c;
+        if (mapDepth == 32) {
+          map.entries += bytes({qBlue(c), qGreen(c), qRed(c), qAlpha(c)});
+        } else if (mapDepth == 24) {
+          map.entries += bytes({qBlue(c), qGreen(c), qRed(c)});
+          color |= 0xff000000u;
+        } else {
+          const int v = int(c & 0xffff);
+          map.entries += word(v);
+          color = qRgb(expand5((v >> 10) & 31), expand5((v >> 5) & 31),
+                       expand5(v & 31));
+        }
+        const int index = map.first + i;
+        encodings.append(
+            {indexDepth == 8 ? bytes({index}) : word(index), color});
+      }
+      checkType(rng, 1, indexDepth, encodings, map);
+      if (QTest::currentTestFailed())
+        return;
+    }
+  }
+}
+
+// Packets by hand: a run and a raw packet that each continue on the next row,
+// a run over several rows, and a run past the last pixel
+void TestTgaCodec::packetsCrossRows() {
+  const QRgb red = qRgb(255, 0, 0);
+  const QRgb green = qRgb(0, 255, 0);
+  const QRgb blue = qRgb(0, 0, 255);
+  const QByteArray header = bytes({0, 0, 10}) + QByteArray(9, '\0') +
+                            word(3) + word(3) + bytes({24});
+  const QByteArray packets =
+      bytes({0x83, 0, 0, 255}) + // 4 red
+      bytes({0x03, 0, 255, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255}); // GBGR
+  const QByteArray tail = bytes({0x80, 255, 0, 0}); // 1 blue
+
+  QImage expected(3, 3, QImage::Format_ARGB32);
+  const QRgb stream[] = {red, red, red, red, green, blue, green, red, blue};
+  for (int descriptor : {0x00, 0x20}) {
+    for (int i = 0; i < 9; ++i) {
+      const int y = descriptor & 0x20 ? i / 3 : 2 - i / 3;
+      expected.setPixel(i % 3, y, stream[i]);
+    }
+    compareImages(decode(header + bytes({descriptor}) + packets + tail),
+                  expected, QString("Descriptor %1").arg(descriptor));
+    if (QTest::currentTestFailed())
+      return;
+  }
+
+  // One run packet over all twenty rows and past the last pixel, and a stray
+  // packet after it
+  QImage flat(5, 20, QImage::Format_ARGB32);
+  flat.fill(blue);
+  const QByteArray flatHeader = bytes({0, 0, 10}) + QByteArray(9, '\0') +
+                                word(5) + word(20) + bytes({24, 0x20});
+  compareImages(decode(flatHeader + bytes({0xff, 255, 0, 0}) +
+                       bytes({0xff, 255, 0, 0})),
+                flat, "Runs over several rows");
+}
+
+// Short files leave the missing pixels transparent; short headers and
+// unsupported types give null images
+void TestTgaCodec::truncated() {
+  QRandomGenerator rng(4);
+  QVector<Encoding> bgra;
+  for (int i = 0; i < 6; ++i) {
+    const QRgb c = rng.generate() | 0xff000000u;
+    bgra.append({bytes({qBlue(c), qGreen(c), qRed(c), qAlpha(c)}), c});
+  }
+  const Sample sample = randomSample(rng, QSize(8, 6), bgra);
+  QImage expected = sample.expected;
+  for (int y = 3; y < 6; ++y) {
+    for (int x = 0; x < 8; ++x)
+      expected.setPixel(x, y, 0);
+  }
+  // Three rows and part of the fourth, which a raw file does not decode
+  const QByteArray file = encode(sample, 2, 32, 0x20);
+  compareImages(decode(file.left(file.size() - 3 * 8 * 4 + 5)), expected,
+                "Truncated");
+
+  QVERIFY(decode(file.left(17)).isNull());
+  QByteArray unsupported = file;
+  unsupported[2] = char(1); // Colour-mapped without a colour map
+  QVERIFY(decode(unsupported).isNull());
+  unsupported[2] = char(4);
+  QVERIFY(decode(unsupported).isNull());
+}
+
+// Written files read back identically, from memory and from disk
+void TestTgaCodec::roundTrip() {
+  QRandomGenerator rng(5);
+  QImage image(300, 7, QImage::Format_ARGB32);
+  for (int y = 0; y < image.height(); ++y) {
+    // Noise, runs past the 128-pixel packet limit and pairs
+    for (int x = 0; x < image.width(); ++x) {
+      QRgb c = rng.generate();
+      if (x >= 100 && x < 260)
+        c = 0xff102030u;
+      else if (x >= 260 && x % 2)
+        c = image.pixel(x - 1, y);
+      image.setPixel(x, y, c);
+    }
+  }
+
+  for (bool rle : {false, true}) {
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(TgaCodec::write(image, &buffer, rle));
+    compareImages(decode(buffer.data()), image,
+                  rle ? "RLE round trip" : "Raw round trip");
+    if (QTest::currentTestFailed())
+      return;
+  }
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("frame.tga");
+  const QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+  QVERIFY(TgaCodec::write(rgb, path));
+  QCOMPARE(TgaCodec::readSize(path), rgb.size());
+  compareImages(TgaCodec::read(path),
+                rgb.convertToFormat(QImage::Format_ARGB32), "File round trip");
+}
+
+QTEST_APPLESS_MAIN(TestTgaCodec)
+#include "tst_tgacodec.moc"
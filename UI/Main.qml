@@ -28,11 +28,17 @@ ApplicationWindow {
         function onRequestImageRefresh() {
             refreshCounter++;
         }
+        function onExportFinished(success, message) {
+            exportResultDialog.title = success ? qsTr("Success") : qsTr("Export Failed");
+            exportResultDialog.text = message;
+            exportResultDialog.open();
+        }
     }
 
     // Undo Shortcut
     Shortcut {
         sequence: "Ctrl+Z"
+        enabled: app.canUndo
         onActivated: {
             console.log("Undo triggered");
             app.undo();
@@ -42,6 +48,7 @@ ApplicationWindow {
     // Redo Shortcuts
     Shortcut {
         sequence: "Ctrl+Y"
+        enabled: app.canRedo
         onActivated: {
             console.log("Redo (Ctrl+Y) triggered");
             app.redo();
@@ -49,19 +56,37 @@ ApplicationWindow {
     }
     Shortcut {
         sequence: "Ctrl+Shift+Z"
+        enabled: app.canRedo
         onActivated: {
             console.log("Redo (Ctrl+Shift+Z) triggered");
             app.redo();
         }
     }
 
+    // Cancel an in-progress sequence load
+    Shortcut {
+        sequence: "Esc"
+        enabled: app.loading
+        onActivated: app.cancelLoading()
+    }
+
     menuBar: AppMenuBar {
         onOpenSequenceTriggered: openFileDialog.open()
-        onExportTriggered: exportFolderDialog.open()
+        onExportTriggered: {
+            exportFolderDialog.modifiedOnly = false;
+            exportFolderDialog.open();
+        }
+        onExportModifiedTriggered: {
+            exportFolderDialog.modifiedOnly = true;
+            exportFolderDialog.open();
+        }
         onBatchPaletteTriggered: colorReplaceDialog.show()
 
         onCheckGuideColorTriggered: guideColorDialog.show()
         onAlphaCheckTriggered: alphaCheckDialog.show()
+        onSpeckCleanupTriggered: speckCleanupDialog.show()
+        onBucketFillTriggered: bucketFillDialog.show()
+        onPropagateColorsTriggered: colorPropagationDialog.show()
     }
 
     // Main Layout - Vertical Split (Canvas Top, Timeline Bottom)
@@ -93,6 +118,8 @@ ApplicationWindow {
                 id: canvasView
                 anchors.fill: parent
                 colorDialogOpen: colorReplaceDialog.visible // Bind to dialog visibility
+                fillToolActive: bucketFillDialog.visible
+                onFillRequested: (x, y) => bucketFillDialog.fillAt(x, y)
             }
 
             // Status Overlay (Creative Pro Style: Minimal text in corner)
@@ -251,6 +278,18 @@ ApplicationWindow {
         id: alphaCheckDialog
     }
 
+    SpeckCleanupDialog {
+        id: speckCleanupDialog
+    }
+
+    BucketFillDialog {
+        id: bucketFillDialog
+    }
+
+    ColorPropagationDialog {
+        id: colorPropagationDialog
+    }
+
     FileDialog {
         id: openFileDialog
         title: qsTr("Open Image Sequence")
@@ -263,18 +302,14 @@ ApplicationWindow {
 
     FolderDialog {
         id: exportFolderDialog
+        property bool modifiedOnly: false
         title: qsTr("Select Export Directory")
-        onAccepted: {
-            if (app.saveSequence(selectedFolder)) {
-                successDialog.open();
-            }
-        }
+        onAccepted: app.saveSequence(selectedFolder, modifiedOnly)
     }
 
     MessageDialog {
-        id: successDialog
+        id: exportResultDialog
         title: qsTr("Success")
-        text: qsTr("Sequence exported successfully.")
         buttons: MessageDialog.Ok
     }
 
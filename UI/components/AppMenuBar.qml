@@ -10,10 +10,14 @@ Rectangle {
 
     signal openSequenceTriggered
     signal exportTriggered
+    signal exportModifiedTriggered
     signal batchPaletteTriggered
 
     signal checkGuideColorTriggered
     signal alphaCheckTriggered
+    signal speckCleanupTriggered
+    signal bucketFillTriggered
+    signal propagateColorsTriggered
 
     Rectangle {
         width: parent.width
@@ -82,6 +86,31 @@ Rectangle {
                     text: qsTr("Export")
                     onTriggered: exportTriggered()
                 }
+                MenuItem {
+                    text: qsTr("Export Modified Frames")
+                    onTriggered: exportModifiedTriggered()
+                }
+                MenuItem {
+                    // Decode frames on demand with a 2 GB cache; applies on next open
+                    text: qsTr("Low Memory Mode")
+                    checkable: true
+                    checked: app.frameCacheBudgetMB > 0
+                    onTriggered: app.setFrameCacheBudgetMB(checked ? 2048 : 0)
+                }
+                MenuItem {
+                    // Store frames with up to 256 colours as palette images
+                    text: qsTr("Indexed Color Storage")
+                    checkable: true
+                    checked: app.indexedStorage
+                    onTriggered: app.setIndexedStorage(checked)
+                }
+                MenuItem {
+                    // Keep decoded frames in a sidecar file for fast reopen
+                    text: qsTr("Cache Decoded Sequences")
+                    checkable: true
+                    checked: app.sequenceCacheEnabled
+                    onTriggered: app.setSequenceCacheEnabled(checked)
+                }
                 MenuSeparator {
                     contentItem: Rectangle {
                         implicitWidth: 200
@@ -151,6 +180,26 @@ Rectangle {
                     text: qsTr("Validate Alpha")
                     onTriggered: alphaCheckTriggered()
                 }
+                MenuItem {
+                    text: qsTr("Clean Up Specks")
+                    onTriggered: speckCleanupTriggered()
+                }
+                MenuItem {
+                    text: qsTr("Bucket Fill")
+                    onTriggered: bucketFillTriggered()
+                }
+                MenuItem {
+                    text: qsTr("Propagate Colors")
+                    onTriggered: propagateColorsTriggered()
+                }
+                MenuItem {
+                    text: qsTr("Clear QC Markers")
+                    onTriggered: app.clearMarkers(false)
+                }
+                MenuItem {
+                    text: qsTr("Clear All QC Markers")
+                    onTriggered: app.clearMarkers(true)
+                }
             }
         }
 
@@ -0,0 +1,207 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import QtQuick.Window
+import "../Theme.js" as Theme
+
+// Tool window for the bucket fill; while it is open, clicks on the canvas fill
+Window {
+    id: root
+    width: 600
+    height: 400
+    visible: false
+    title: qsTr("Bucket Fill")
+    color: Theme.background
+    flags: Qt.Dialog | Qt.CustomizeWindowHint | Qt.WindowTitleHint | Qt.WindowCloseButtonHint
+
+    property color fillColor: "white"
+
+    // Prevent closing, just hide
+    onClosing: close => {
+        close.accepted = false;
+        root.hide();
+    }
+
+    function fillAt(x, y) {
+        if (rangeBox.currentIndex === 0) {
+            app.bucketFill(x, y, root.fillColor, toleranceSlider.value, gapSlider.value);
+        } else {
+            // Spin boxes count frames from 1
+            app.bucketFill(x, y, root.fillColor, toleranceSlider.value, gapSlider.value,
+                           firstSpin.value - 1, lastSpin.value - 1);
+        }
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 15
+        spacing: 15
+
+        // Header
+        Label {
+            text: qsTr("Bucket Fill")
+            color: Theme.text
+            font.pixelSize: Theme.fontPixelSize
+            font.bold: true
+        }
+
+        Divider {
+            Layout.fillWidth: true
+        }
+
+        // Settings Grid
+        GridLayout {
+            columns: 3
+            Layout.fillWidth: true
+            rowSpacing: 15
+            columnSpacing: 10
+
+            // Row 1: Fill Color
+            Label {
+                text: qsTr("Fill Color:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.alignment: Qt.AlignVCenter
+            }
+            Rectangle {
+                Layout.preferredWidth: 60
+                Layout.preferredHeight: 30
+                color: root.fillColor
+                border.color: Theme.panelBorder
+                border.width: 1
+
+                MouseArea {
+                    anchors.fill: parent
+                    cursorShape: Qt.PointingHandCursor
+                    onClicked: {
+                        colorPicker.setColor(root.fillColor);
+                        colorPicker.show();
+                    }
+                }
+            }
+            Label {
+                text: "(" + root.fillColor.toString() + ")"
+                color: Theme.textDisabled
+                font.pixelSize: Theme.smallFontPixelSize
+                Layout.fillWidth: true
+            }
+
+            // Row 2: Tolerance
+            Label {
+                text: qsTr("Tolerance:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            Slider {
+                id: toleranceSlider
+                from: 0
+                to: 64
+                value: 0
+                stepSize: 1
+                Layout.fillWidth: true
+            }
+            Label {
+                text: Math.round(toleranceSlider.value)
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.preferredWidth: 60
+                horizontalAlignment: Text.AlignRight
+            }
+
+            // Row 3: Gap closing
+            Label {
+                text: qsTr("Close Gaps:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            Slider {
+                id: gapSlider
+                // Openings in the line art up to twice this wide hold the fill
+                from: 0
+                to: 8
+                value: 0
+                stepSize: 1
+                Layout.fillWidth: true
+            }
+            Label {
+                text: Math.round(gapSlider.value) + " px"
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.preferredWidth: 60
+                horizontalAlignment: Text.AlignRight
+            }
+
+            // Row 4: Frames
+            Label {
+                text: qsTr("Frames:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            ComboBox {
+                id: rangeBox
+                // A range fills the region under the same point in every frame
+                model: [qsTr("Current frame"), qsTr("Frame range")]
+                Layout.fillWidth: true
+                Layout.columnSpan: 2
+            }
+
+            Label {
+                text: qsTr("Range:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                enabled: rangeBox.currentIndex === 1
+            }
+            RowLayout {
+                Layout.columnSpan: 2
+                spacing: 10
+                enabled: rangeBox.currentIndex === 1
+
+                SpinBox {
+                    id: firstSpin
+                    from: 1
+                    to: Math.max(1, app.frameCount)
+                    value: 1
+                }
+                Label {
+                    text: qsTr("to")
+                    color: Theme.text
+                    font.pixelSize: Theme.fontPixelSize
+                }
+                SpinBox {
+                    id: lastSpin
+                    from: 1
+                    to: Math.max(1, app.frameCount)
+                    value: Math.max(1, app.frameCount)
+                }
+            }
+        }
+
+        Item {
+            Layout.fillHeight: true
+        } // Spacer
+
+        Divider {
+            Layout.fillWidth: true
+        }
+
+        Label {
+            text: qsTr("Click the canvas to fill.")
+            color: Theme.textDisabled
+            font.pixelSize: Theme.smallFontPixelSize
+        }
+    }
+
+    ColorPicker {
+        id: colorPicker
+        title: qsTr("Select Fill Color")
+        onAccepted: color => {
+            root.fillColor = color;
+        }
+    }
+
+    // Helper Components (Standardized)
+    component Divider: Rectangle {
+        height: 1
+        color: Theme.panelBorder
+    }
+}
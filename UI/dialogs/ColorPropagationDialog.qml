@@ -0,0 +1,207 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import QtQuick.Window
+import "../Theme.js" as Theme
+
+Window {
+    id: root
+    width: 600
+    height: 400
+    visible: false
+    title: qsTr("Propagate Colors")
+    color: Theme.background
+    flags: Qt.Dialog | Qt.CustomizeWindowHint | Qt.WindowTitleHint | Qt.WindowCloseButtonHint
+
+    property color lineColor: "black"
+    property color markerColor: "yellow"
+
+    // Prevent closing, just hide
+    onClosing: close => {
+        close.accepted = false;
+        root.hide();
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 15
+        spacing: 15
+
+        // Header
+        Label {
+            text: qsTr("Propagate Colors from Current Frame")
+            color: Theme.text
+            font.pixelSize: Theme.fontPixelSize
+            font.bold: true
+        }
+
+        Divider {
+            Layout.fillWidth: true
+        }
+
+        // Settings Grid
+        GridLayout {
+            columns: 3
+            Layout.fillWidth: true
+            rowSpacing: 15
+            columnSpacing: 10
+
+            // Row 1: Line art colour
+            Label {
+                text: qsTr("Line Color:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.alignment: Qt.AlignVCenter
+            }
+            Rectangle {
+                Layout.preferredWidth: 60
+                Layout.preferredHeight: 30
+                color: root.lineColor
+                border.color: Theme.panelBorder
+                border.width: 1
+
+                MouseArea {
+                    anchors.fill: parent
+                    cursorShape: Qt.PointingHandCursor
+                    onClicked: {
+                        colorPicker.target = "line";
+                        colorPicker.setColor(root.lineColor);
+                        colorPicker.show();
+                    }
+                }
+            }
+            Label {
+                text: "(" + root.lineColor.toString() + ")"
+                color: Theme.textDisabled
+                font.pixelSize: Theme.smallFontPixelSize
+                Layout.fillWidth: true
+            }
+
+            // Row 2: Line tolerance
+            Label {
+                text: qsTr("Line Tolerance:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            Slider {
+                id: toleranceSlider
+                from: 0
+                to: 128
+                value: 64
+                stepSize: 1
+                Layout.fillWidth: true
+            }
+            Label {
+                text: Math.round(toleranceSlider.value)
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.preferredWidth: 60
+                horizontalAlignment: Text.AlignRight
+            }
+
+            // Row 3: Last frame
+            Label {
+                text: qsTr("Through Frame:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            SpinBox {
+                id: lastSpin
+                from: 1
+                to: Math.max(1, app.frameCount)
+                value: Math.max(1, app.frameCount)
+                Layout.columnSpan: 2
+            }
+
+            // Row 4: Review marker colour
+            Label {
+                text: qsTr("Review Color:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.alignment: Qt.AlignVCenter
+            }
+            Rectangle {
+                Layout.preferredWidth: 60
+                Layout.preferredHeight: 30
+                color: root.markerColor
+                border.color: Theme.panelBorder
+                border.width: 1
+
+                MouseArea {
+                    anchors.fill: parent
+                    cursorShape: Qt.PointingHandCursor
+                    onClicked: {
+                        colorPicker.target = "marker";
+                        colorPicker.setColor(root.markerColor);
+                        colorPicker.show();
+                    }
+                }
+            }
+            Label {
+                text: "(" + root.markerColor.toString() + ")"
+                color: Theme.textDisabled
+                font.pixelSize: Theme.smallFontPixelSize
+                Layout.fillWidth: true
+            }
+        }
+
+        Item {
+            Layout.fillHeight: true
+        } // Spacer
+
+        Divider {
+            Layout.fillWidth: true
+        }
+
+        // Action Buttons
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 10
+
+            StandardButton {
+                text: qsTr("Propagate")
+                Layout.fillWidth: true
+                isAccent: true
+                onClicked: {
+                    // Spin box counts frames from 1
+                    app.propagateColors(lastSpin.value - 1, root.lineColor, toleranceSlider.value, root.markerColor);
+                }
+            }
+        }
+    }
+
+    ColorPicker {
+        id: colorPicker
+        property string target: "line"
+        title: target === "line" ? qsTr("Select Line Color") : qsTr("Select Review Color")
+        onAccepted: color => {
+            if (target === "line")
+                root.lineColor = color;
+            else
+                root.markerColor = color;
+        }
+    }
+
+    // Helper Components (Standardized)
+    component Divider: Rectangle {
+        height: 1
+        color: Theme.panelBorder
+    }
+
+    component StandardButton: Button {
+        property bool isAccent: false
+        background: Rectangle {
+            color: parent.down ? Theme.buttonPressed : (parent.hovered ? Theme.buttonHover : (isAccent ? Theme.accent : Theme.buttonNormal))
+            radius: 2
+            border.color: Theme.panelBorder
+        }
+        contentItem: Text {
+            text: parent.text
+            color: isAccent ? "white" : Theme.text
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+            font.pixelSize: Theme.fontPixelSize
+            font.bold: isAccent
+        }
+    }
+}
@@ -13,6 +13,12 @@ Window {
     color: Theme.background
     flags: Qt.Dialog | Qt.CustomizeWindowHint | Qt.WindowTitleHint | Qt.WindowCloseButtonHint
 
+    // The preview only makes sense while the table is being edited
+    onVisibleChanged: {
+        if (!visible)
+            app.setSwapPreviewEnabled(false);
+    }
+
     ColumnLayout {
         anchors.fill: parent
         anchors.margins: 15
@@ -273,9 +279,32 @@ Window {
                 }
             }
 
+            ComboBox {
+                // Order matches ColorMetric
+                model: [qsTr("Per channel"), qsTr("Euclidean RGB"), qsTr("CIE Lab ΔE"), qsTr("Premultiplied")]
+                currentIndex: app.colorSwapModel.metric
+                onActivated: index => app.colorSwapModel.metric = index
+                font.pixelSize: Theme.smallFontPixelSize
+            }
+
             Item {
                 Layout.fillWidth: true
             }
+
+            CheckBox {
+                id: previewCheckBox
+                text: qsTr("Live Preview")
+                checked: app.swapPreviewEnabled
+                onToggled: app.setSwapPreviewEnabled(checked)
+
+                contentItem: Text {
+                    text: previewCheckBox.text
+                    color: Theme.text
+                    font.pixelSize: Theme.smallFontPixelSize
+                    leftPadding: previewCheckBox.indicator.width + previewCheckBox.spacing
+                    verticalAlignment: Text.AlignVCenter
+                }
+            }
         }
 
         // Actions
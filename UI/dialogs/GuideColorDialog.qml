@@ -333,6 +333,18 @@ Window {
                     Layout.preferredWidth: 40
                 }
             }
+
+            Text {
+                text: "Color Metric:"
+                color: Theme.text
+            }
+            ComboBox {
+                // Order matches ColorMetric
+                model: [qsTr("Per channel"), qsTr("Euclidean RGB"), qsTr("CIE Lab ΔE"), qsTr("Premultiplied")]
+                currentIndex: app.guideCheckModel.metric
+                onActivated: index => app.guideCheckModel.metric = index
+                Layout.fillWidth: true
+            }
         }
 
         Divider {
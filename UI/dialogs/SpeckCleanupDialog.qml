@@ -0,0 +1,182 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import QtQuick.Window
+import "../Theme.js" as Theme
+
+Window {
+    id: root
+    width: 600
+    height: 400
+    visible: false
+    title: qsTr("Clean Up Specks")
+    color: Theme.background
+    flags: Qt.Dialog | Qt.CustomizeWindowHint | Qt.WindowTitleHint | Qt.WindowCloseButtonHint
+
+    property color markerColor: "magenta"
+
+    // Prevent closing, just hide
+    onClosing: close => {
+        close.accepted = false;
+        root.hide();
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 15
+        spacing: 15
+
+        // Header
+        Label {
+            text: qsTr("Clean Up Specks")
+            color: Theme.text
+            font.pixelSize: Theme.fontPixelSize
+            font.bold: true
+        }
+
+        Divider {
+            Layout.fillWidth: true
+        }
+
+        // Settings Grid
+        GridLayout {
+            columns: 3
+            Layout.fillWidth: true
+            rowSpacing: 15
+            columnSpacing: 10
+
+            // Row 1: Largest speck
+            Label {
+                text: qsTr("Max Speck Area:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            Slider {
+                id: areaSlider
+                from: 1
+                to: 64
+                value: 5
+                stepSize: 1
+                Layout.fillWidth: true
+            }
+            Label {
+                text: Math.round(areaSlider.value) + " px"
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.preferredWidth: 60
+                horizontalAlignment: Text.AlignRight
+            }
+
+            // Row 2: Mode
+            Label {
+                text: qsTr("Action:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+            }
+            ComboBox {
+                id: modeBox
+                // Absorbing fills each speck with its dominant neighbouring colour
+                model: [qsTr("Mark"), qsTr("Absorb into neighbours")]
+                Layout.fillWidth: true
+                Layout.columnSpan: 2
+            }
+
+            // Row 3: Indicator Color
+            Label {
+                text: qsTr("Indicator Color:")
+                color: Theme.text
+                font.pixelSize: Theme.fontPixelSize
+                Layout.alignment: Qt.AlignVCenter
+                enabled: modeBox.currentIndex === 0
+            }
+            Rectangle {
+                Layout.preferredWidth: 60
+                Layout.preferredHeight: 30
+                color: root.markerColor
+                border.color: Theme.panelBorder
+                border.width: 1
+                opacity: modeBox.currentIndex === 0 ? 1.0 : 0.4
+
+                MouseArea {
+                    anchors.fill: parent
+                    cursorShape: Qt.PointingHandCursor
+                    enabled: modeBox.currentIndex === 0
+                    onClicked: {
+                        colorPicker.setColor(root.markerColor);
+                        colorPicker.show();
+                    }
+                }
+            }
+            Label {
+                text: "(" + root.markerColor.toString() + ")"
+                color: Theme.textDisabled
+                font.pixelSize: Theme.smallFontPixelSize
+                Layout.fillWidth: true
+            }
+        }
+
+        Item {
+            Layout.fillHeight: true
+        } // Spacer
+
+        Divider {
+            Layout.fillWidth: true
+        }
+
+        // Action Buttons
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 10
+
+            StandardButton {
+                text: qsTr("Clean Current")
+                Layout.fillWidth: true
+                Layout.preferredWidth: 1
+                onClicked: {
+                    app.cleanupSpecks(false, areaSlider.value, modeBox.currentIndex === 1, root.markerColor);
+                }
+            }
+
+            StandardButton {
+                text: qsTr("Clean All")
+                Layout.fillWidth: true
+                Layout.preferredWidth: 1
+                isAccent: true
+                onClicked: {
+                    app.cleanupSpecks(true, areaSlider.value, modeBox.currentIndex === 1, root.markerColor);
+                }
+            }
+        }
+    }
+
+    ColorPicker {
+        id: colorPicker
+        title: qsTr("Select Indicator Color")
+        onAccepted: color => {
+            root.markerColor = color;
+        }
+    }
+
+    // Helper Components (Standardized)
+    component Divider: Rectangle {
+        height: 1
+        color: Theme.panelBorder
+    }
+
+    component StandardButton: Button {
+        property bool isAccent: false
+        background: Rectangle {
+            color: parent.down ? Theme.buttonPressed : (parent.hovered ? Theme.buttonHover : (isAccent ? Theme.accent : Theme.buttonNormal))
+            radius: 2
+            border.color: Theme.panelBorder
+        }
+        contentItem: Text {
+            text: parent.text
+            color: isAccent ? "white" : Theme.text
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+            font.pixelSize: Theme.fontPixelSize
+            font.bold: isAccent
+        }
+    }
+}
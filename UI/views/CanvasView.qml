@@ -1,5 +1,6 @@
 import QtQuick
 import QtQuick.Controls
+import QtQuick.Shapes
 
 Item {
     id: root
@@ -9,6 +10,9 @@ Item {
     property alias contentWidth: displayImage.width
     property alias contentHeight: displayImage.height
     property bool colorDialogOpen: false
+    property bool fillToolActive: false
+
+    signal fillRequested(int x, int y)
 
     function fitToScreen() {
         let sx = width / displayImage.sourceSize.width
@@ -41,7 +45,8 @@ Item {
 
         Image {
             id: displayImage
-            source: "image://sequence/current?r=" + (Window.window ? Window.window.refreshCounter : 0)
+            source: "image://sequence/" + (app.swapPreviewActive ? "preview" : "current")
+                    + "?r=" + (Window.window ? Window.window.refreshCounter : 0)
             scale: zoomArea.scaleFactor
             x: zoomArea.tx + (zoomArea.width - width * scale) / 2
             y: zoomArea.ty + (zoomArea.height - height * scale) / 2
@@ -55,15 +60,60 @@ Item {
                 anchors.fill: parent
                 hoverEnabled: true
                 acceptedButtons: Qt.LeftButton
+                cursorShape: root.fillToolActive && !root.colorDialogOpen ? Qt.CrossCursor : Qt.ArrowCursor
                 
                 onClicked: (mouse) => {
-                    if (root.colorDialogOpen) {
+                    if (root.colorDialogOpen || root.fillToolActive) {
                         let px = Math.floor(mouse.x)
                         let py = Math.floor(mouse.y)
                         
                         if (px >= 0 && px < displayImage.sourceSize.width &&
                             py >= 0 && py < displayImage.sourceSize.height) {
-                            app.pickColorAt(px, py)
+                            if (root.colorDialogOpen)
+                                app.pickColorAt(px, py)
+                            else
+                                root.fillRequested(px, py)
+                        }
+                    }
+                }
+            }
+
+            // QC markers, drawn over the frame in image pixels
+            Repeater {
+                model: app.currentMarkers
+
+                delegate: Item {
+                    required property var modelData
+                    x: modelData.x
+                    y: modelData.y
+
+                    Rectangle {
+                        visible: modelData.kind === "circle"
+                        // The stroke is centred on the radius, as when painted
+                        width: 2 * modelData.size + modelData.thickness
+                        height: width
+                        x: -width / 2
+                        y: -height / 2
+                        radius: width / 2
+                        color: "transparent"
+                        border.color: modelData.color
+                        border.width: modelData.thickness
+                    }
+
+                    Shape {
+                        id: cross
+                        visible: modelData.kind === "cross"
+                        readonly property int half: Math.floor(modelData.size / 2)
+
+                        ShapePath {
+                            strokeColor: modelData.color
+                            strokeWidth: modelData.thickness
+                            fillColor: "transparent"
+                            startX: -cross.half
+                            startY: -cross.half
+                            PathLine { x: cross.half; y: cross.half }
+                            PathMove { x: -cross.half; y: cross.half }
+                            PathLine { x: cross.half; y: -cross.half }
                         }
                     }
                 }
@@ -148,7 +198,8 @@ Item {
         anchors.left: parent.left
         anchors.margins: 10
         text: zoomArea.spaceHeld ? "Pan Mode: Drag to pan" : 
-              (root.colorDialogOpen ? "Click to pick color" : "Space+Drag to Pan | Scroll to Zoom")
+              (root.colorDialogOpen ? "Click to pick color" :
+              (root.fillToolActive ? "Click to fill" : "Space+Drag to Pan | Scroll to Zoom"))
         color: "#aaaaaa"
         font.pixelSize: 12
     }
@@ -36,7 +36,9 @@ int main(int argc, char *argv[]) {
   QQmlApplicationEngine engine;
 
   // Register image provider (engine takes ownership)
-  engine.addImageProvider("sequence", new ImageSequenceProvider(&sequence));
+  engine.addImageProvider(
+      "sequence",
+      new ImageSequenceProvider(&sequence, controller.swapPreview()));
 
   // Set context properties
   engine.rootContext()->setContextProperty("app", &controller);